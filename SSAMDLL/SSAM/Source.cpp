@@ -20,6 +20,7 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <cfloat>
 #include "SSAM.h" 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -32,11 +33,24 @@ namespace argnames
 	const std::string TTC  = "ttc";
 	const std::string PET  = "pet"; 
 	const std::string nthreads = "nthreads";
+	const std::string prefetch = "prefetch";
+	const std::string fileworkers = "fileworkers";
+	const std::string timeslices = "timeslices";
+	const std::string starttime = "starttime";
+	const std::string endtime = "endtime";
+	const std::string useindex = "-index";
+	const std::string buildindex = "-buildindex";
+	const std::string buildcache = "-buildcache";
+	const std::string nocache = "-nocache";
+	const std::string stream = "-stream";
+	const std::string membudget = "membudget";
 	const std::string dat = "-dat";
 	const std::string h			= "-h";
 	const std::string help		= "-help";
 	const std::string p = "-print";
 	const std::string puea = "-puea";
+	const std::string continuousttc = "-continuousttc";
+	const std::string sweepprune = "-sweepprune";
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -60,6 +74,19 @@ void usage()
 #ifdef _OPENMP_LOCAL
 	std::cout << nthreads << "=n\t- specify the number of threads (default is the number of logic processors)" << std::endl;
 #endif
+	std::cout << prefetch << "=n\t- decode up to n time steps ahead of the analysis on a reader thread (default = 0, read inline)" << std::endl;
+	std::cout << fileworkers << "=n\t- analyze up to n trj files concurrently (default = 1)" << std::endl;
+	std::cout << timeslices << "=n\t- split each trj file into n time slices analyzed concurrently (default = 1)" << std::endl;
+	std::cout << starttime << "=f\t- analyze conflicts starting at or after f seconds (default = start of file)" << std::endl;
+	std::cout << endtime << "=f\t- analyze conflicts starting at or before f seconds (default = end of file)" << std::endl;
+	std::cout << useindex << "\t\t- load the time step index of each trj file from a .idx file, or build and save it" << std::endl;
+	std::cout << buildindex << "\t- only build and save the time step index of each trj file" << std::endl;
+	std::cout << buildcache << "\t- only convert each trj file into a columnar .ssc cache file, read instead of the trj file by later runs" << std::endl;
+	std::cout << nocache << "\t- read the trj files even if they have an up-to-date cache file" << std::endl;
+	std::cout << membudget << "=n\t- keep up to n MB of conflicts in memory and spill the rest to a file next to the csv file (default = 0, no limit)" << std::endl;
+	std::cout << stream << "\t- write the conflict listing to the csv file as conflicts are found, without keeping them in memory" << std::endl;
+	std::cout << continuousttc << "\t- find the TTC as the first contact of the projected paths instead of in steps of 0.1 s" << std::endl;
+	std::cout << sweepprune << "\t- find the vehicles to check for crashes by sorting them along the area instead of by a grid of zones, for corridors" << std::endl;
 	std::cout << p << "\t\t- output progress to screen" << std::endl;
 	std::cout << std::endl << "options may be specified in any order." << std::endl;
 	std::cout << std::endl;
@@ -81,6 +108,11 @@ int main(int argc, char* args[])
 		std::string errMsg;
 		std::string trjFiles;
 		std::string csvFile;
+		float windowStart = -FLT_MAX;
+		float windowEnd = FLT_MAX;
+		bool isBuildIndex = false;
+		bool isBuildCache = false;
+		bool isStream = false;
 
 		std::cout << "SSAM received " << argc << " argument(s)\n";
 		for (int i = 1; i < argc; ++i)
@@ -166,6 +198,138 @@ int main(int argc, char* args[])
 				} 
 			}
 #endif
+			else if(argument.substr(0, prefetch.length()) == prefetch)
+			{
+				if( argument.length() <= prefetch.length()+1)
+				{
+					std::cerr << "warning: prefetch argument with no value ignored.\n";
+					continue;
+				} 
+				
+				int depth = 0;
+				try 
+				{ 
+					depth = std::stoi(argument.substr(prefetch.length()+1));
+					if(depth < 0)
+						throw SSAMException("value " + std::to_string(depth) + " must not be a negative number");
+				} catch (const std::invalid_argument& e)
+				{
+					errMsg = "error: invalid integer value, use prefetch=16 (for example)\nextra error info: "; 
+					errMsg += e.what();
+					throw SSAMException(errMsg);
+				} 
+				SSAMRunner.SetPrefetchDepth(depth);
+			}
+			else if(argument.substr(0, membudget.length()) == membudget)
+			{
+				if( argument.length() <= membudget.length()+1)
+				{
+					std::cerr << "warning: membudget argument with no value ignored.\n";
+					continue;
+				} 
+				
+				int megabytes = 0;
+				try 
+				{ 
+					megabytes = std::stoi(argument.substr(membudget.length()+1));
+					if(megabytes < 0)
+						throw SSAMException("value " + std::to_string(megabytes) + " must not be a negative number");
+				} catch (const std::invalid_argument& e)
+				{
+					errMsg = "error: invalid integer value, use membudget=512 (for example)\nextra error info: "; 
+					errMsg += e.what();
+					throw SSAMException(errMsg);
+				} 
+				SSAMRunner.SetConflictMemoryBudget((size_t)megabytes << 20);
+			}
+			else if(argument.substr(0, fileworkers.length()) == fileworkers)
+			{
+				if( argument.length() <= fileworkers.length()+1)
+				{
+					std::cerr << "warning: fileworkers argument with no value ignored.\n";
+					continue;
+				} 
+				
+				int nWorkers = 1;
+				try 
+				{ 
+					nWorkers = std::stoi(argument.substr(fileworkers.length()+1));
+					if(nWorkers < 1)
+						throw SSAMException("value " + std::to_string(nWorkers) + " must be a positive number");
+				} catch (const std::invalid_argument& e)
+				{
+					errMsg = "error: invalid integer value, use fileworkers=4 (for example)\nextra error info: "; 
+					errMsg += e.what();
+					throw SSAMException(errMsg);
+				} 
+				SSAMRunner.SetNFileWorkers(nWorkers);
+			}
+			else if(argument.substr(0, timeslices.length()) == timeslices)
+			{
+				if( argument.length() <= timeslices.length()+1)
+				{
+					std::cerr << "warning: timeslices argument with no value ignored.\n";
+					continue;
+				} 
+				
+				int nSlices = 1;
+				try 
+				{ 
+					nSlices = std::stoi(argument.substr(timeslices.length()+1));
+					if(nSlices < 1)
+						throw SSAMException("value " + std::to_string(nSlices) + " must be a positive number");
+				} catch (const std::invalid_argument& e)
+				{
+					errMsg = "error: invalid integer value, use timeslices=4 (for example)\nextra error info: "; 
+					errMsg += e.what();
+					throw SSAMException(errMsg);
+				} 
+				SSAMRunner.SetNTimeSlices(nSlices);
+			}
+			else if(argument.substr(0, starttime.length()) == starttime || argument.substr(0, endtime.length()) == endtime)
+			{
+				bool isStart = (argument.substr(0, starttime.length()) == starttime);
+				const std::string& name = isStart ? starttime : endtime;
+				if( argument.length() <= name.length()+1)
+				{
+					std::cerr << "warning: " << name << " argument with no value ignored.\n";
+					continue;
+				} 
+				
+				try 
+				{ 
+					float t = std::stof(argument.substr(name.length()+1));
+					if (isStart)
+						windowStart = t;
+					else
+						windowEnd = t;
+				} catch (const std::invalid_argument& e)
+				{
+					errMsg = "error: invalid decimal value, use " + name + "=3600 (for example)\nextra error info: "; 
+					errMsg += e.what();
+					throw SSAMException(errMsg);
+				} 
+			}
+			else if(argument == buildindex)
+			{
+				isBuildIndex = true;
+			}
+			else if(argument == buildcache)
+			{
+				isBuildCache = true;
+			}
+			else if(argument == nocache)
+			{
+				SSAMRunner.SetUseCache(false);
+			}
+			else if(argument == stream)
+			{
+				isStream = true;
+			}
+			else if(argument == useindex)
+			{
+				SSAMRunner.SetUseIndex(true);
+			}
 			else if(argument == p)
 			{
 				SSAMRunner.SetPrintProgess(true);
@@ -179,6 +343,14 @@ int main(int argc, char* args[])
 				SSAMRunner.SetIsCalcPUEA(true);
 				
 			}
+			else if(argument == continuousttc)
+			{
+				SSAMRunner.SetTTCEngine(Event::CONTINUOUS_TTC);
+			}
+			else if(argument == sweepprune)
+			{
+				SSAMRunner.SetBroadphase(SSAMFuncs::SSAM::SWEEP_PRUNE_BROADPHASE);
+			}
 			else if(argument.substr(0, help.size()) ==  help || argument.substr(0, h.size()) == h)
 			{
 				usage();
@@ -198,15 +370,54 @@ int main(int argc, char* args[])
 
 		std::stringstream ss(trjFiles);
 		for (std::string field; std::getline(ss, field, ','); SSAMRunner.AddTrjFile(field));
+
+		if (isBuildIndex || isBuildCache)
+		{
+			const std::list<std::string>& fileNames = SSAMRunner.GetTrjFileNames();
+			for (std::list<std::string>::const_iterator it = fileNames.begin(); it != fileNames.end(); ++it)
+			{
+				if (it->empty())
+					continue;
+				if (isBuildIndex)
+				{
+					SSAMRunner.BuildTrjIndex(*it);
+					std::cout << "Built index of " << *it << std::endl;
+				}
+				if (isBuildCache)
+				{
+					SSAMRunner.BuildTrjCache(*it);
+					std::cout << "Built cache of " << *it << std::endl;
+				}
+			}
+			return 0;
+		}
+
+		if (windowStart > windowEnd)
+			throw SSAMException("error: starttime is after endtime");
+		SSAMRunner.SetTimeWindow(windowStart, windowEnd);
 	
 #ifdef _OPENMP_LOCAL
 		std::cout << "nThreads: " << nThreads << std::endl;
 		SSAMRunner.SetNThreads(nThreads);
 #endif
+		if (!csvFile.empty())
+			SSAMRunner.SetConflictSpillFile(csvFile + ".spill");
+		std::shared_ptr<CsvConflictSink> pCsvSink;
+		if (isStream && !csvFile.empty())
+		{
+			// the listing is written on a writer thread while the analysis goes on
+			pCsvSink = std::make_shared<CsvConflictSink>(csvFile);
+			SSAMRunner.SetConflictSink(std::make_shared<AsyncConflictSink>(pCsvSink));
+			SSAMRunner.SetRetainConflicts(false);
+		}
 		SSAMRunner.Analyze();
 		std::cout << "Analysis complete.\n";
 
-		if(!csvFile.empty())
+		if (pCsvSink != NULL)
+		{
+			std::cout << "Completed writing " << pCsvSink->GetNConflicts() << " conflicts to CSV file: " << csvFile << std::endl;
+		}
+		else if(!csvFile.empty())
 		{
 			SSAMRunner.ExportResults();
 		}
@@ -0,0 +1,101 @@
+/*------------------------------------------------------------------------------
+   Copyright  2016-2017
+   New Global Systems for Intelligent Transportation Management Corp.
+
+   This file is part of SSAM.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Affero General Public License as
+   published by the Free Software Foundation, either version 3 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------------*/
+#pragma once
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+/** BoundedQueue passes items from a producer thread to a consumer thread.
+  * Push() blocks while the queue is full, which throttles the producer to the
+  * pace of the consumer.
+*/
+template <typename T>
+class BoundedQueue
+{
+public:
+	/** Create a queue.
+	 * @param capacity maximum number of queued items
+	 */
+	explicit BoundedQueue(size_t capacity)
+		: m_Capacity(capacity > 0 ? capacity : 1)
+		, m_IsClosed(false)
+	{}
+	~BoundedQueue() {}
+
+	/** Add an item to the queue, waiting while the queue is full.
+	 * @param item the item to add
+	 * @return false if the queue was closed and the item is dropped
+	 */
+	bool Push(const T& item)
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		while (!m_IsClosed && m_Items.size() >= m_Capacity)
+			m_NotFull.wait(lock);
+		if (m_IsClosed)
+			return false;
+		m_Items.push_back(item);
+		m_NotEmpty.notify_one();
+		return true;
+	}
+
+	/** Remove the oldest item from the queue, waiting while the queue is empty.
+	 * @param item the removed item as output value
+	 * @return false if the queue is closed and has no more items
+	 */
+	bool Pop(T& item)
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		while (!m_IsClosed && m_Items.empty())
+			m_NotEmpty.wait(lock);
+		if (m_Items.empty())
+			return false;
+		item = m_Items.front();
+		m_Items.pop_front();
+		m_NotFull.notify_one();
+		return true;
+	}
+
+	/** Close the queue. Waiting producers and consumers are released,
+	 * and items already queued can still be popped.
+	 */
+	void Close()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_IsClosed = true;
+		m_NotFull.notify_all();
+		m_NotEmpty.notify_all();
+	}
+
+	size_t GetCapacity() const { return m_Capacity; }
+private:
+	size_t m_Capacity; /*!< Maximum number of queued items */
+	bool m_IsClosed; /*!< Flag to indicate whether the queue is closed */
+	std::deque<T> m_Items; /*!< Queued items */
+	std::mutex m_Mutex; /*!< Mutex guarding the queue */
+	std::condition_variable m_NotFull; /*!< Signaled when an item is removed */
+	std::condition_variable m_NotEmpty; /*!< Signaled when an item is added */
+
+	BoundedQueue(const BoundedQueue&);
+	BoundedQueue& operator=(const BoundedQueue&);
+};
+
+#endif
@@ -0,0 +1,43 @@
+/*------------------------------------------------------------------------------
+   Copyright  2016-2017
+   New Global Systems for Intelligent Transportation Management Corp.
+
+   This file is part of SSAM.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Affero General Public License as
+   published by the Free Software Foundation, either version 3 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------------*/
+#pragma once
+#ifndef COLLISIONKERNEL_H
+#define COLLISIONKERNEL_H
+
+/** CollisionKernel tests the edges of one footprint against the edges of a batch of footprints at once,
+  * with SSE instructions where the compiler targets them, otherwise one footprint after another.
+  * The edges are tested as CheckLinesIntersect does, with the same operations in the same order,
+  * so that a batch finds the same collisions as the footprints tested one by one.
+*/
+class CollisionKernel
+{
+public:
+	static const int BATCH_SIZE = 4; /*!< Number of footprints tested at once */
+
+	/** Test whether the edges of a footprint cross the edges of each footprint of a batch.
+	 * @param cornerX X coordinates of the four corners of the footprint
+	 * @param cornerY Y coordinates of the four corners of the footprint
+	 * @param batchX X coordinates of the corners of the batch, corner k of footprint b at [BATCH_SIZE*k + b]
+	 * @param batchY Y coordinates of the corners of the batch, corner k of footprint b at [BATCH_SIZE*k + b]
+	 * @return a mask with bit b set if the edges of footprint b cross the edges of the footprint
+	 */
+	static int CrossEdges(const float* cornerX, const float* cornerY, const float* batchX, const float* batchY);
+};
+#endif // COLLISIONKERNEL_H
@@ -221,7 +221,7 @@ public:
 	/** Get a numeric safety measure using its column order.
 	  * @param i column order of the safety measure, starting from 0.
     */
-	float GetMeasure(int i)
+	float GetMeasure(int i) const
 	{
 		switch(i)
 		{
@@ -0,0 +1,127 @@
+/*------------------------------------------------------------------------------
+   Copyright  2016-2017
+   New Global Systems for Intelligent Transportation Management Corp.
+
+   This file is part of SSAM.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Affero General Public License as
+   published by the Free Software Foundation, either version 3 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------------*/
+#pragma once
+#ifndef CONFLICTSINK_H
+#define CONFLICTSINK_H
+#include <string>
+#include <memory>
+#include <fstream>
+#include <thread>
+#include <exception>
+#include "Conflict.h"
+#include "BoundedQueue.h"
+
+#ifdef SSAMDLL_EXPORTS
+#define SSAMFUNCSDLL_API __declspec(dllexport) 
+#else
+#define SSAMFUNCSDLL_API __declspec(dllimport) 
+#endif
+
+/** ConflictSink receives each conflict as soon as its conflict event is finished,
+  * which is about MaxPET seconds of simulation after the conflict.
+  * The conflicts are delivered in the order of the conflict list of SSAM.
+*/
+class ConflictSink
+{
+public:
+	virtual ~ConflictSink() {}
+
+	/** Receive a conflict.
+	 * @param c smart pointer to the conflict
+	 */
+	virtual void OnConflict(SP_Conflict c) = 0;
+
+	/** Called when an analysis run is finished and no more conflicts follow.
+	 */
+	virtual void Flush() {}
+};
+
+/** Smart pointer type to ConflictSink class.
+*/
+typedef std::shared_ptr<ConflictSink> SP_ConflictSink;
+
+/** AsyncConflictSink passes conflicts to another sink on a dedicated writer thread,
+  * so that a slow sink does not hold up the analysis.
+*/
+class SSAMFUNCSDLL_API AsyncConflictSink : public ConflictSink
+{
+public:
+	/** Create a sink that forwards conflicts to a writer thread.
+	 * @param pSink smart pointer to the sink called on the writer thread
+	 * @param capacity maximum number of conflicts waiting for the writer thread
+	 */
+	AsyncConflictSink(SP_ConflictSink pSink, size_t capacity = 4096);
+	~AsyncConflictSink();
+
+	/** Queue a conflict for the writer thread, waiting while the queue is full.
+	 * @param c smart pointer to the conflict
+	 */
+	void OnConflict(SP_Conflict c);
+
+	/** Wait until the writer thread has delivered all queued conflicts, and flush the wrapped sink.
+	 * An error raised by the wrapped sink on the writer thread is rethrown here.
+	 */
+	void Flush();
+private:
+	SP_ConflictSink m_pSink; /*!< Smart pointer to the sink called on the writer thread */
+	size_t m_Capacity; /*!< Maximum number of conflicts waiting for the writer thread */
+	std::unique_ptr<BoundedQueue<SP_Conflict> > m_pQueue; /*!< Conflicts waiting for the writer thread */
+	std::thread m_Writer; /*!< The writer thread */
+	std::exception_ptr m_WriteError; /*!< The first error raised by the wrapped sink */
+
+	/** Wait for the writer thread to deliver the queued conflicts and stop it.
+	 */
+	void Stop();
+
+	AsyncConflictSink(const AsyncConflictSink&);
+	AsyncConflictSink& operator=(const AsyncConflictSink&);
+};
+
+/** CsvConflictSink writes the conflict listing to a csv file one conflict at a time.
+*/
+class SSAMFUNCSDLL_API CsvConflictSink : public ConflictSink
+{
+public:
+	/** Create the csv file and write the heading of the conflict listing.
+	 * @param csvFileName name of the csv file
+	 */
+	explicit CsvConflictSink(const std::string& csvFileName);
+	~CsvConflictSink() {}
+
+	void OnConflict(SP_Conflict c);
+	void Flush();
+	int GetNConflicts() const { return m_NConflicts; }
+
+	/** Write the column labels of the conflict listing.
+	 * @param os output stream
+	 */
+	static void WriteListingLabels(std::ostream& os);
+
+	/** Write one conflict as a row of the conflict listing.
+	 * @param os output stream
+	 * @param c the conflict to write
+	 */
+	static void WriteListingRow(std::ostream& os, const Conflict& c);
+private:
+	std::string m_CsvFileName; /*!< Name of the csv file */
+	std::ofstream m_CsvFile; /*!< The csv file */
+	int m_NConflicts; /*!< Number of conflicts written */
+};
+#endif // CONFLICTSINK_H
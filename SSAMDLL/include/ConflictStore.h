@@ -0,0 +1,103 @@
+/*------------------------------------------------------------------------------
+   Copyright  2016-2017
+   New Global Systems for Intelligent Transportation Management Corp.
+
+   This file is part of SSAM.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Affero General Public License as
+   published by the Free Software Foundation, either version 3 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------------*/
+#pragma once
+#ifndef CONFLICTSTORE_H
+#define CONFLICTSTORE_H
+#include <string>
+#include <list>
+#include <map>
+#include <vector>
+#include <fstream>
+#include <functional>
+#include "Conflict.h"
+
+/** ConflictStore keeps the conflicts of an analysis within a memory budget.
+  * When the conflicts in memory exceed the budget, they are moved in one segment
+  * to a spill file of fixed-size binary records, in which the two strings of a conflict
+  * are replaced by indexes into string tables kept in memory. The conflicts are
+  * iterated in the order they were added, the spilled conflicts first.
+*/
+class ConflictStore
+{
+public:
+	ConflictStore();
+	~ConflictStore();
+
+	/** Set the memory budget.
+	 * @param bytes maximum number of bytes of the conflicts kept in memory, 0 for no limit
+	 */
+	void SetMemoryBudget(size_t bytes) { m_MemoryBudget = bytes; }
+
+	/** Set the name of the spill file, which is removed when the store is cleared.
+	 * @param fileName name of the spill file
+	 */
+	void SetSpillFileName(const std::string& fileName) { m_SpillFileName = fileName; }
+
+	/** Add a conflict, and spill the conflicts in memory if they exceed the memory budget.
+	 * @param c smart pointer to the conflict
+	 */
+	void Add(SP_Conflict c);
+
+	/** Call a function on each conflict in the order the conflicts were added.
+	 * A spilled conflict is read into a temporary object that is valid during the call only.
+	 * @param f function to call
+	 */
+	void ForEach(const std::function<void(const Conflict&)>& f);
+
+	/** Remove all conflicts and the spill file.
+	 */
+	void Clear();
+
+	/** Estimate the memory used by a conflict in the store.
+	 * @param c the conflict
+	 * @return number of bytes
+	 */
+	static size_t GetConflictBytes(const Conflict& c);
+
+	size_t GetMemoryBudget() const { return m_MemoryBudget; }
+	const std::string& GetSpillFileName() const { return m_SpillFileName; }
+	size_t GetSize() const { return m_NSpilled + m_Conflicts.size(); }
+	size_t GetNSpilled() const { return m_NSpilled; }
+	size_t GetMemoryBytes() const { return m_MemoryBytes; }
+	bool IsEmpty() const { return GetSize() == 0; }
+private:
+	size_t m_MemoryBudget; /*!< Maximum number of bytes of the conflicts kept in memory, 0 for no limit */
+	std::string m_SpillFileName; /*!< Name of the spill file */
+	std::list<SP_Conflict> m_Conflicts; /*!< Conflicts kept in memory, added after the spilled conflicts */
+	size_t m_MemoryBytes; /*!< Estimated number of bytes of the conflicts kept in memory */
+	std::ofstream m_SpillFile; /*!< The spill file, open once the first conflict is spilled */
+	size_t m_NSpilled; /*!< Number of conflicts in the spill file */
+	std::vector<std::string> m_Strings; /*!< Strings of the spilled conflicts */
+	std::map<std::string, int> m_StringIndexes; /*!< Indexes of the strings of the spilled conflicts */
+
+	/** Move the conflicts in memory to the spill file.
+	 */
+	void Spill();
+
+	/** Get the index of a string of a spilled conflict, adding the string if it is new.
+	 * @param s the string
+	 * @return index of the string
+	 */
+	int GetStringIndex(const std::string& s);
+
+	ConflictStore(const ConflictStore&);
+	ConflictStore& operator=(const ConflictStore&);
+};
+#endif // CONFLICTSTORE_H
@@ -24,19 +24,21 @@
 #include <string>
 #include <vector>
 #include "Vehicle.h"
+#include "ProjectionCache.h"
 #include "MotionPrediction.h"
 
 /** InitParams organizes parameters for creating a conflict event.
 */
 struct InitEventParams
 {
-	SP_Vehicle m_V1; /*!< First Vehicle in the conflict event*/
-	SP_Vehicle m_V2; /*!< Second Vehicle in the conflict event*/
+	const Vehicle* m_pV1; /*!< First Vehicle in the conflict event*/
+	const Vehicle* m_pV2; /*!< Second Vehicle in the conflict event*/
 	float m_MaxTTC; /*!< Max TTC threshold*/
 	float m_MaxPET; /*!< Max PET threshold*/
 	int m_RearEndAngleThreshold; /*!< Rear-end Angle Threshold*/
 	int m_CrossingAngleThreshold; /*!< Crossing Angle Threshold*/
 	bool m_IsCalcPUEA; /*!< Flag to indicate whether to calculate P(UEA), mTTC, mPET*/
+	int m_TTCEngine; /*!< Method to find the TTC, one of Event::TTC_ENGINE*/
 	int m_NSteps;
 	double m_CollisionThreshold; /*!< a distance threshold to determine whether two vehicles collide*/
 	MotPredNameSpace::SP_NormalAdaption m_pNormalAdaption;
@@ -45,6 +47,8 @@ struct InitEventParams
 
 /** Event maintains the continueous vehicle data for the pair of vehicles
   * involved in one conflict event, and calculates safety measures when the conflict is confirmed.
+  * The vehicle data are copies, so an event keeps no time step alive. The next index of the last copy
+  * refers to the first time step of the analysis window, which is the time step after the last data.
   * Safety measure variables are defined same as the safety measures defined in document: 
   * Surrogate Safety Assessment Model and Validation: Final Report, 
   * Publication No. FHWA-HRT-08-051, JUNE 2008,
@@ -62,19 +66,41 @@ public:
 	*/
 	Event(const InitEventParams& params); 
 
+	/** Start a new conflict event in this object, keeping the memory of the vehicle data of the previous event.
+	* @param params Initial parameters.
+	*/
+	void Reset(const InitEventParams& params);
+
+	/** TTC_ENGINE enumerates the methods to find the TTC of a time step
+	*/
+	enum TTC_ENGINE
+	{
+		SWEEP_TTC, /*!< Test the projections at TTC values from maxTTC down to 0 by TTC_STEP_SIZE */
+		CONTINUOUS_TTC /*!< Solve the first contact of the projected paths in continuous time */
+	};
+
 	const static float INVALID_SSM_VALUE;
+	const static float TTC_STEP_SIZE; /*!< Step size when decrementing maxTTC to find the exact TTC*/
+
+	/** Get the number of TTC values of the sweep from maxTTC down to 0.
+	 * @param maxTTC Max TTC threshold.
+	 * @return number of TTC values
+	 */
+	static int GetNTTCs(float maxTTC);
 
 	/**Add new vehicle data.
 	 * @param v1 First vehicle.
 	 * @param v2 Second vehicle.
 	 */
 	//--------------------------------------------------------------------------
-	void AddVehicleData(SP_Vehicle v1, SP_Vehicle v2); 
+	void AddVehicleData(const Vehicle& v1, const Vehicle& v2); 
 	
 	/**Analyze event data up this time step.
 	 * @param t This time step for analysis.
+	 * @param window Vehicles of the time steps of the analysis window, the first of which is this time step.
+	 * @param projections Projections of the vehicles of this time step, shared by the events.
 	 */
-	bool AnalyzeData(float t); 
+	bool AnalyzeData(float t, const StepWindow& window, ProjectionCache& projections); 
 
 	//	Get()/Set() methods
 	float	GetMinTTCTime()	{ return tMinTTC; }
@@ -121,6 +147,7 @@ public:
 	float	GetMTTC() {return mTTC;}
 	float	GetMPET() {return mPET;}
 	bool 	IsConflict()	{ return m_IsConflict; }
+	float	GetFirstTimeStep()	{ return m_FirstTTC; }
 private:
 	// safety measure variables
 	float tMinTTC;
@@ -170,8 +197,8 @@ private:
 	// member variables
 	int m_LowVID;  /*!< Lower ID of the pair of vehicles*/
 	int m_HighVID; /*!< Higher ID of the pair of vehicles*/
-	std::vector<SP_Vehicle> m_LowVData;  /*!< Data of vehicle with lower ID*/
-	std::vector<SP_Vehicle> m_HighVData; /*!< Data of vehicle with higher ID*/
+	std::vector<Vehicle> m_LowVData;  /*!< Data of vehicle with lower ID*/
+	std::vector<Vehicle> m_HighVData; /*!< Data of vehicle with higher ID*/
 	float m_MaxTTC; /*!< Max TTC threshold*/
 	float m_MaxPET; /*!< Max PET threshold*/
 	int m_RearEndAngle; /*!< Rear-end Angle Threshold*/
@@ -188,6 +215,7 @@ private:
 	bool m_IsConflict; 	/*!< Flag of whether current event is a conflict*/
 	bool m_IsPETComplete;	/*!< Flag of whether PET calculations are complete */
 	bool m_IsCalculatePUEA; /*!< Flag to calculate P(UEA), mTTC and mPET */
+	int m_TTCEngine; /*!< Method to find the TTC, one of TTC_ENGINE */
 
 	// variables for calculating mTTC, mPET and P(UEA)
 	MotPredNameSpace::SP_NormalAdaption m_pNormalAdaption;
@@ -199,6 +227,25 @@ private:
 	/**Calculate safety measures.
 	 */
 	void CalcMeasures();
+
+	/**Find the TTC of a time step by testing the projections from maxTTC down to 0.
+	 * The TTC is the lowest TTC of the first run of collided projections.
+	 * @param vLo vehicle with lower ID.
+	 * @param vHi vehicle with higher ID.
+	 * @param projections Projections of the vehicles of the time step.
+	 * @param stepTTC output TTC.
+	 * @return true if the projections collide.
+	 */
+	bool SweepTTC(const Vehicle& vLo, const Vehicle& vHi, ProjectionCache& projections, float& stepTTC);
+
+	/**Find the TTC of a time step as the first contact of the projected paths.
+	 * @param vLo vehicle with lower ID.
+	 * @param vHi vehicle with higher ID.
+	 * @param projections Projections of the vehicles of the time step.
+	 * @param ttc output TTC.
+	 * @return true if the projected paths collide.
+	 */
+	bool SolveTTC(const Vehicle& vLo, const Vehicle& vHi, ProjectionCache& projections, float& ttc);
 	
 };
 
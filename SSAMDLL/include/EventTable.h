@@ -0,0 +1,111 @@
+/*------------------------------------------------------------------------------
+   Copyright  2016-2017
+   New Global Systems for Intelligent Transportation Management Corp.
+
+   This file is part of SSAM.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Affero General Public License as
+   published by the Free Software Foundation, either version 3 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------------*/
+#pragma once
+#ifndef EVENTTABLE_H
+#define EVENTTABLE_H
+#include <utility>
+#include <vector>
+#include "Event.h"
+
+/** EventTable keeps the open conflict events by the pair of IDs of their vehicles.
+  * The events are found by a hash table with open addressing, keyed by the pair packed in 64 bits,
+  * from which an event is removed by shifting back the entries after it, so that no removed entries pile up.
+  * The events are kept in a pool and reused by later events with the memory of their vehicle data.
+  * The events are visited in the order of the pairs, the order in which conflicts are created:
+  * the events added in a time step are sorted and merged into the events already in order.
+*/
+class EventTable
+{
+public:
+	EventTable();
+
+	/** Pack the IDs of a pair of vehicles in one key.
+	 * @param lowID lower vehicle ID
+	 * @param highID higher vehicle ID
+	 * @return the key
+	 */
+	static unsigned long long PackPair(int lowID, int highID)
+	{
+		return ((unsigned long long)(unsigned int)lowID << 32) | (unsigned int)highID;
+	}
+
+	/** Find the event of a pair of vehicles.
+	 * @param lowID lower vehicle ID
+	 * @param highID higher vehicle ID
+	 * @return pointer to the event, NULL if the pair has no event
+	 */
+	Event* Find(int lowID, int highID) const;
+
+	/** Add an event for a pair of vehicles that has no event.
+	 * The event is visited in order after the next call to Order.
+	 * @param lowID lower vehicle ID
+	 * @param highID higher vehicle ID
+	 * @param params initial parameters of the event
+	 */
+	void Add(int lowID, int highID, const InitEventParams& params);
+
+	/** Merge the events added since the last call into the events in the order of the pairs.
+	 */
+	void Order();
+
+	/** Remove an event in order. The positions of the other events are kept until Compact is called.
+	 * @param k position of the event in order
+	 */
+	void Remove(size_t k);
+
+	/** Close the gaps of the events removed from the order.
+	 */
+	void Compact();
+
+	/** Remove all events, keeping the pool of events to reuse.
+	 */
+	void Clear();
+
+	size_t GetSize() const { return m_NEvents; }
+	bool IsEmpty() const { return m_NEvents == 0; }
+	size_t GetNOrdered() const { return m_Order.size(); }
+	const SP_Event& GetEvent(size_t k) const { return m_Events[m_Order[k]]; }
+	const std::pair<int, int>& GetPair(size_t k) const { return m_Pairs[m_Order[k]]; }
+
+private:
+	static const unsigned long long EMPTY_KEY = ~0ULL; /*!< Key of an empty entry, the pair of two vehicles with ID -1 */
+
+	std::vector<unsigned long long> m_Keys; /*!< Keys of the entries of the hash table, EMPTY_KEY for an empty entry */
+	std::vector<int> m_Slots; /*!< Slots in the pool of the events of the entries of the hash table */
+	std::vector<SP_Event> m_Events; /*!< Pool of events, by slot */
+	std::vector<std::pair<int, int> > m_Pairs; /*!< Pairs of vehicle IDs of the events, by slot */
+	std::vector<int> m_FreeSlots; /*!< Slots of the pool not used by an open event */
+	std::vector<int> m_Order; /*!< Slots of the events in the order of the pairs, -1 for a removed event */
+	std::vector<int> m_Added; /*!< Slots of the events added since the last call to Order */
+	size_t m_NEvents; /*!< Number of open events */
+
+	/** Find the entry of the hash table of a key.
+	 * @param key the key
+	 * @return index of the entry of the key, or of the empty entry where the key is to be added
+	 */
+	size_t FindEntry(unsigned long long key) const;
+
+	/** Change the number of entries of the hash table, adding the events again.
+	 * @param nEntries number of entries, a power of two
+	 */
+	void Rehash(size_t nEntries);
+};
+
+#endif
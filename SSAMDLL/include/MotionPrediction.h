@@ -22,6 +22,8 @@
 #define MOTIONPREDICTION_H
 #include "Utility.h"
 #include <vector>
+#include <random>
+#include <algorithm>
 
 /* Developed from paper
 Mohamed, Mohamed, and Nicolas Saunier. 
@@ -35,6 +37,11 @@ Transportation Research Record: Journal of the Transportation Research Board 238
 */
 namespace MotPredNameSpace
 {
+/** Random number engine of the predicted trajectories. Each conflict event seeds its own,
+  * so that its measures do not depend on the order in which the events are analyzed.
+*/
+typedef std::mt19937 RandomEngine;
+
 /** PredObj organizes vehicle position and velocity at one step.
 */
 struct PredObj
@@ -114,21 +121,25 @@ public:
 	{}
 	~TriangularDistri() {}
 
-	double operator()()
+	/** Draw a value of the distribution.
+	  * @param random the random number engine
+	  * @return the value
+	*/
+	double operator()(RandomEngine& random) const
 	{
-		double u = double(rand()) / double(RAND_MAX);
+		double u = double(random() - random.min()) / double(random.max() - random.min());
 		
-		double c = (m_Mode - m_Low) / (m_High - m_Low);
+		double low = m_Low;
+		double high = m_High;
+		double c = (m_Mode - low) / (high - low);
 		if (u > c)
 		{
 			u = 1.0 - u;
 			c = 1.0 - c;
-			double tmp = m_High;
-			m_High = m_Low;
-			m_Low = tmp;
+			std::swap(low, high);
 		}
 		
-		return m_Low + (m_High - m_Low) * sqrt(u * c);
+		return low + (high - low) * sqrt(u * c);
 	}
 
 private:
@@ -201,6 +212,7 @@ public:
 	PredTrajRandom(const PredObj& initObj,
 		double maxSpeed)
 		: PredTraj(initObj, maxSpeed)
+		, m_pRandom(NULL)
 	{	}
 
 	~PredTrajRandom(){}
@@ -208,23 +220,29 @@ public:
 	/** Set triangular distributions for generating acceleration rate and steering angle at each step
 	  * @param accelDistri a triangular distribution for generating acceleration rate
 	  * @param steerDistri a triangular distribution for generating steering angle
+	  * @param pRandom pointer to the random number engine, which must outlive the trajectory
 	*/
 	void SetDistributions(const TriangularDistri& accelDistri, 
-		const TriangularDistri& steerDistri)
+		const TriangularDistri& steerDistri,
+		RandomEngine* pRandom)
 	{
 		m_AccelDistri = accelDistri;
 		m_SteerDistri = steerDistri;
+		m_pRandom = pRandom;
 	}
 
 	/** Get a set of acceleration rate and steering angle
 	*/
 	virtual NormAngle GetControl()
 	{
-		return NormAngle(m_AccelDistri(), m_SteerDistri());
+		double accel = m_AccelDistri(*m_pRandom);
+		double steer = m_SteerDistri(*m_pRandom);
+		return NormAngle(accel, steer);
 	}
 private:
 	TriangularDistri m_AccelDistri;  /*!< a triangular distribution for generating acceleration rate */
 	TriangularDistri m_SteerDistri;  /*!< a triangular distribution for generating steering angle */
+	RandomEngine* m_pRandom; /*!< random number engine of the trajectory */
 };
 
 /** Smart pointer type to PredTrajRandom class.
@@ -318,9 +336,11 @@ protected:
 	/** Generate a set of trajectories
 	  * @param obj initial vehicle position and velocity 
 	  * @param[out] predTrajs the set of generated trajectories
+	  * @param random the random number engine
 	*/
 	virtual void GenPredTrajs(const PredObj& obj,
-		std::vector<SP_PredTraj>& predTrajs) = 0;
+		std::vector<SP_PredTraj>& predTrajs,
+		RandomEngine& random) = 0;
 
 	/** Detect collision between two vehicles
 	  * @param pTrj1 smart pointer to the trajectory of first vehicle
@@ -381,15 +401,18 @@ public:
 	/** Generate a set of trajectories
 	  * @param obj initial vehicle position and velocity 
 	  * @param[out] predTrajs the set of generated trajectories
+	  * @param random the random number engine
 	*/
 	virtual void GenPredTrajs(const PredObj& obj,
-		std::vector<SP_PredTraj>& predTrajs);
+		std::vector<SP_PredTraj>& predTrajs,
+		RandomEngine& random);
 
 	/** Calculate mTTC and mPET
 	  * @param obj1 initial position and velocity of first vehicle
 	  * @param obj2 initial position and velocity of second vehicle
 	  * @param collisionThreshold a distance threshold to determine whether two vehicles collide
 	  * @param nSteps number of steps to detect
+	  * @param random the random number engine
 	  * @param[out] mTTC the calculated mTTC
 	  * @param[out] mPET the calculated mPET
 	*/
@@ -397,6 +420,7 @@ public:
 		const PredObj& obj2, 
 		double collisionThreshold, 
 		int nSteps,
+		RandomEngine& random,
 		float& mTTC, float& mPET);	
 };
 
@@ -434,21 +458,25 @@ public:
 	/** Generate a set of trajectories
 	  * @param obj initial vehicle position and velocity 
 	  * @param[out] predTrajs the set of generated trajectories
+	  * @param random the random number engine
 	*/
 	virtual void GenPredTrajs(const PredObj& obj,
-		std::vector<SP_PredTraj>& predTrajs);
+		std::vector<SP_PredTraj>& predTrajs,
+		RandomEngine& random);
 	
 	/** Calculate P(UEA)
 	  * @param obj1 initial position and velocity of first vehicle
 	  * @param obj2 initial position and velocity of second vehicle
 	  * @param collisionThreshold a distance threshold to determine whether two vehicles collide
 	  * @param nSteps number of steps to detect
+	  * @param random the random number engine
 	  * @return the calcualted P(UEA)
 	*/
 	float CalcPUEA(const PredObj& obj1, 
 		const PredObj& obj2, 
 		double collisionThreshold, 
-		int nSteps);
+		int nSteps,
+		RandomEngine& random);
 };
 
 /** Smart pointer type to EvasiveAction class.
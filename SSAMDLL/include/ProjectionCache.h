@@ -0,0 +1,104 @@
+/*------------------------------------------------------------------------------
+   Copyright  2016-2017
+   New Global Systems for Intelligent Transportation Management Corp.
+
+   This file is part of SSAM.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Affero General Public License as
+   published by the Free Software Foundation, either version 3 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------------*/
+#pragma once
+#ifndef PROJECTIONCACHE_H
+#define PROJECTIONCACHE_H
+#include <deque>
+#include <vector>
+#include "Vehicle.h"
+#include "VehicleTracks.h"
+
+/** ProjectionCache keeps the projections of the vehicles of the time step being analyzed, keyed by
+  * the track of the vehicle and the index of the TTC in the sweep of an event, so that a vehicle taking part
+  * in several events is projected once for each TTC. The projections at the first TTC of the sweep, which is
+  * maxTTC, are those calculated for the zone grid and take the first footprints, in the order of the vehicles.
+  * The projected paths of the vehicles, by which the TTC is found in continuous time, are kept by the track likewise.
+*/
+class ProjectionCache
+{
+public:
+	ProjectionCache();
+
+	/** Start a time step, dropping the projections of the previous time step.
+	 * @param nVehicles number of vehicles of the time step
+	 * @param tracks tracks of the vehicles in the analysis window, by which the projections are calculated
+	 * @param nTTCs number of TTC values of the sweep of an event
+	 */
+	void BeginTimeStep(size_t nVehicles, const VehicleTracks& tracks, int nTTCs);
+
+	/** Project a vehicle of the time step at maxTTC into the footprint of the same index.
+	 * Different vehicles may be projected in parallel.
+	 * @param iv index of the vehicle in the time step
+	 * @param v the vehicle
+	 * @param maxTTC maxTTC threshold
+	 * @param maxPET maxPET threshold
+	 */
+	void ProjectVehicle(size_t iv, const Vehicle& v, float maxTTC, float maxPET);
+
+	/** Get the projection of a vehicle of the time step at a TTC of the sweep, calculating it at the first request.
+	 * @param v the vehicle
+	 * @param k index of the TTC in the sweep
+	 * @param ttc the TTC
+	 * @param maxPET maxPET threshold
+	 * @return index of the footprint, valid until the next time step
+	 */
+	size_t GetProjection(const Vehicle& v, int k, float ttc, float maxPET);
+
+	/** Get the projected path of a vehicle of the time step, calculating it at the first request.
+	 * @param v the vehicle
+	 * @param maxTTC maxTTC threshold
+	 * @param maxPET maxPET threshold
+	 * @return pieces of the path, valid until the next time step
+	 */
+	const std::vector<PathPiece>& GetPath(const Vehicle& v, float maxTTC, float maxPET);
+
+	/** Add the counters of another cache, e.g. the cache of a worker.
+	 * @param other the other cache
+	 */
+	void AddCounts(const ProjectionCache& other);
+
+	/** Reset the counters, e.g. after they are added to another cache.
+	 */
+	void ClearCounts() { m_NHits = 0; m_NMisses = 0; }
+
+	const VehicleShapes& GetShapes() const { return m_Shapes; }
+	long long GetNHits() const { return m_NHits; }
+	long long GetNMisses() const { return m_NMisses; }
+private:
+	const VehicleTracks* m_pTracks; /*!< Tracks of the vehicles in the analysis window */
+	int m_NTTCs; /*!< Number of TTC values of the sweep */
+	std::vector<int> m_Slots; /*!< Footprint indexes by track ID * m_NTTCs + TTC index, -1 if not calculated */
+	VehicleShapes m_Shapes; /*!< Footprints of the projections */
+	size_t m_NShapes; /*!< Number of footprints in use */
+	std::vector<int> m_PathSlots; /*!< Path indexes by track ID, -1 if not calculated */
+	std::deque<std::vector<PathPiece> > m_Paths; /*!< Projected paths, kept in place as more are added */
+	size_t m_NPaths; /*!< Number of paths in use */
+	long long m_NHits; /*!< Number of projections found in the cache */
+	long long m_NMisses; /*!< Number of projections calculated on request */
+
+	/** Get a free footprint, making room for it if needed.
+	 * @return index of the footprint
+	 */
+	size_t NewShape();
+
+	ProjectionCache(const ProjectionCache&);
+	ProjectionCache& operator=(const ProjectionCache&);
+};
+#endif // PROJECTIONCACHE_H
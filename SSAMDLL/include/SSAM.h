@@ -22,16 +22,29 @@
 #define SSAM_H
 #include <string>
 #include <list>
+#include <deque>
 #include <map>
+#include <set>
 #include <vector>
+#include <algorithm>
+#include <climits>
 #include <ctime>
 #include <fstream>
+#include <exception>
 #include "Vehicle.h"
+#include "VehicleArena.h"
 #include "ZoneGrid.h"
+#include "SweepPrune.h"
 #include "Event.h"
+#include "EventTable.h"
 #include "Conflict.h"
 #include "MotionPrediction.h"
 #include "Summary.h"
+#include "ConflictSink.h"
+#include "ConflictStore.h"
+#include "TrjReader.h"
+#include "TrjIndex.h"
+#include "TrjCache.h"
 #ifdef _OPENMP_LOCAL
 #include <omp.h>
 #endif
@@ -177,6 +190,24 @@ namespace SSAMFuncs
 			return *this;
 		}
 
+		/** Move contructor from another TrjRecord object, which takes over its dimensions and vehicle without copying them
+		* @param rhs Rvalue reference to a TrjRecord object from which the values are moved
+		*/
+		TrjRecord(TrjRecord&& rhs)
+		{
+			MoveValues(rhs);
+		}
+
+		/** Overloaded move assignment operator
+		* @param rhs Rvalue reference to a TrjRecord object from which the values are moved
+		*/
+		TrjRecord& operator=(TrjRecord&& rhs)
+		{
+			if (this != &rhs)
+				MoveValues(rhs);
+			return *this;
+		}
+
 		/** RECORD_TYPE enumerates the record types in TRJ input
 		*/
 		enum RECORD_TYPE
@@ -220,23 +251,63 @@ namespace SSAMFuncs
 			if (rhs.m_pVehicle != NULL)
 				m_pVehicle = std::make_shared<Vehicle>(*(rhs.m_pVehicle));
 		}
+
+		/** Move values from another TrjRecord object
+		* @param rhs Reference to a TrjRecord object from which the values are moved
+		*/
+		void MoveValues(TrjRecord& rhs)
+		{
+			m_RecordType = rhs.m_RecordType;
+			m_Format = rhs.m_Format;
+			m_TimeStep = rhs.m_TimeStep;
+			m_pDimensions = std::move(rhs.m_pDimensions);
+			m_pVehicle = std::move(rhs.m_pVehicle);
+		}
 	};
 
 	/** Smart pointer type to TrjRecord class.
 	*/
 	typedef std::shared_ptr<TrjRecord> SP_TrjRecord;
 
-	/** TimeStepData manages vehicle data in one time step
+	/** VehicleState is the plain data of one vehicle in one time step,
+	  * in the fields and units of a TRJ vehicle record.
+	*/
+	struct VehicleState
+	{
+		int m_VehicleID; /*!< Vehicle ID */
+		int m_LinkID; /*!< Link ID */
+		int m_LaneID; /*!< Lane ID */
+		float m_FrontX; /*!< X coordinate of the vehicle front */
+		float m_FrontY; /*!< Y coordinate of the vehicle front */
+		float m_FrontZ; /*!< Z coordinate of the vehicle front */
+		float m_RearX; /*!< X coordinate of the vehicle rear */
+		float m_RearY; /*!< Y coordinate of the vehicle rear */
+		float m_RearZ; /*!< Z coordinate of the vehicle rear */
+		float m_Length; /*!< Vehicle length */
+		float m_Width; /*!< Vehicle width */
+		float m_Speed; /*!< Vehicle speed */
+		float m_Acceleration; /*!< Vehicle acceleration */
+	};
+
+	/** TimeStepData manages vehicle data in one time step.
+	  * The vehicles are kept in arrival order in contiguous arrays, and a vehicle is
+	  * found by its ID through a dense ID to index table, or through a sorted ID table
+	  * if the IDs are too sparse for a dense table.
 	*/
 	class TimeStepData
 	{
 	public:
-		TimeStepData(): m_TimeStep(-1) {}
+		/** Create the data of a time step
+		  * @param pArena smart pointer to an empty arena for the vehicles of the time step
+		*/
+		explicit TimeStepData(SP_VehicleArena pArena): m_TimeStep(-1), m_pArena(pArena), m_IsIndexed(false), m_IsSorted(false), m_MinID(0) {}
 
 		void  SetTimestep(float t)	{ m_TimeStep = t; }
 		float GetTimestep() const { return m_TimeStep; }
-		std::map<int, SP_Vehicle>* GetVehicleMap() {return &m_VehicleMap;}
-		std::vector<SP_Vehicle>* GetVehicleVec() {return &m_VehicleVec;}
+		size_t GetNVehicles() const { return m_Vehicles.size(); }
+		const SP_Vehicle& GetVehicle(size_t i) const { return m_Vehicles[i]; }
+		const StepVehicles& GetVehicles() const { return m_Vehicles; }
+		int GetVehicleID(size_t i) const { return m_VehicleIDs[i]; }
 
 		/** Add one vehicle data of current time step
 		  * @param vID ID of the vehicle to add
@@ -244,15 +315,83 @@ namespace SSAMFuncs
 		*/
 		void AddVehicle(int vID, SP_Vehicle v)
 		{
-			m_MapReturn = m_VehicleMap.insert(std::pair<int, SP_Vehicle>(vID, v));
-			if (m_MapReturn.second)
-				m_VehicleVec.push_back(v);
+			m_VehicleIDs.push_back(vID);
+			m_Vehicles.push_back(v);
+			m_IsIndexed = false;
+		}
+
+		/** Allocate a vehicle of current time step in the arena of the time step.
+		  * The vehicle is then added by AddVehicle(Vehicle&), or returned to the arena by FreeVehicle().
+		  * @return reference to the vehicle
+		*/
+		Vehicle& NewVehicle() { return m_pArena->Allocate(); }
+
+		/** Return the vehicle allocated last by NewVehicle() to the arena
+		*/
+		void FreeVehicle() { m_pArena->FreeLast(); }
+
+		/** Add one vehicle allocated by NewVehicle(). The smart pointer to the vehicle shares the ownership of the arena.
+		  * @param v the vehicle
+		*/
+		void AddVehicle(Vehicle& v)
+		{
+			m_VehicleIDs.push_back(v.GetVehicleID());
+			m_Vehicles.push_back(SP_Vehicle(m_pArena, &v));
+			m_IsIndexed = false;
+		}
+
+		/** Reserve room for the vehicles of current time step
+		  * @param n number of vehicles
+		*/
+		void Reserve(size_t n)
+		{
+			m_VehicleIDs.reserve(n);
+			m_Vehicles.reserve(n);
+		}
+
+		/** Build the ID table once all vehicles of the time step are added.
+		  * A vehicle whose ID was already added is removed, as only the first data of a vehicle is used.
+		*/
+		void BuildIndex();
+
+		/** Link each vehicle to its data in the next time step by setting its next index.
+		  * Two time steps with vehicles in ID order are merged in one pass, otherwise the vehicles are looked up in the ID table.
+		  * BuildIndex() must be called on both time steps.
+		  * @param next the next time step
+		  * @return number of vehicles in both time steps
+		*/
+		size_t LinkNext(const TimeStepData& next);
+
+		/** Find a vehicle by its ID. BuildIndex() must be called after the last vehicle is added.
+		  * @param vID ID of the vehicle
+		  * @return index of the vehicle, -1 if the vehicle is not in the time step
+		*/
+		int FindVehicle(int vID) const
+		{
+			if (m_IsSorted)
+			{
+				std::vector<int>::const_iterator it = std::lower_bound(m_VehicleIDs.begin(), m_VehicleIDs.end(), vID);
+				return (it != m_VehicleIDs.end() && *it == vID) ? (int)(it - m_VehicleIDs.begin()) : -1;
+			}
+			if (!m_IndexTable.empty())
+			{
+				unsigned int offset = (unsigned int)vID - (unsigned int)m_MinID;
+				return (offset < m_IndexTable.size()) ? m_IndexTable[offset] : -1;
+			}
+			std::vector<std::pair<int, int> >::const_iterator it = std::lower_bound(m_SortedIDs.begin(), m_SortedIDs.end(),
+				std::pair<int, int>(vID, INT_MIN));
+			return (it != m_SortedIDs.end() && it->first == vID) ? it->second : -1;
 		}
 	private:
 		float m_TimeStep; /*!< Seconds since the start of the simulation */
-		std::map<int, SP_Vehicle>  m_VehicleMap; /*!< A map container stores vehicle smart pointers using vehicle IDs as keys*/
-		std::vector<SP_Vehicle> m_VehicleVec; /*!< A vector container stores vehicle smart pointers*/
-		std::pair<std::map<int, SP_Vehicle>::iterator, bool> m_MapReturn; /*!< A pair stores the return value of inserting new vehicle into map */
+		SP_VehicleArena m_pArena; /*!< Arena of the vehicles allocated by NewVehicle() */
+		std::vector<int> m_VehicleIDs; /*!< IDs of the vehicles, in arrival order */
+		StepVehicles m_Vehicles; /*!< Smart pointers to the vehicles, in arrival order */
+		bool m_IsIndexed; /*!< Flag to indicate whether the ID table is up to date */
+		bool m_IsSorted; /*!< Flag to indicate whether the vehicles arrived in increasing ID order, in which case no ID table is built */
+		int m_MinID; /*!< Smallest vehicle ID, the ID of the first entry of the dense ID table */
+		std::vector<int> m_IndexTable; /*!< Dense table of vehicle indexes by vehicle ID - m_MinID, -1 for IDs not in the time step */
+		std::vector<std::pair<int, int> > m_SortedIDs; /*!< Pairs of vehicle ID and index sorted by ID, used if the IDs are too sparse for a dense table */
 	};
 	/** Smart pointer type to TimeStepData class.
 	*/
@@ -264,6 +403,16 @@ namespace SSAMFuncs
 
 	typedef std::pair<int, int> VehiclePair;
 
+	/** EventRecord keeps the span of a conflict event analyzed in one time slice of a TRJ file
+	*/
+	struct EventRecord
+	{
+		VehiclePair m_Pair; /*!< IDs of the pair of vehicles */
+		float m_FirstTimeStep; /*!< Time step at which the event is created */
+		float m_LastTimeStep; /*!< Time step at which the event is finished, FLT_MAX if the event is still open at the end of file */
+		SP_Conflict m_pConflict; /*!< Smart pointer to the conflict of the event, NULL if the event is not a conflict */
+	};
+
 	/** SSAM reads TRJ input, runs SSAM simulation, and maintains conflict results
      */
 	class SSAM
@@ -278,6 +427,14 @@ namespace SSAMFuncs
 		const static int DEFAULT_REARENDANGLE=30; /*!< default rear end angle threshold */
 		const static int DEFAULT_CROSSINGANGLE=80; /*!< default crossing angle threshold */
 
+		/** BROADPHASE enumerates the methods to find the pairs of vehicles crashing in a time step
+		*/
+		enum BROADPHASE
+		{
+			ZONE_GRID_BROADPHASE, /*!< Vehicles sharing a zone of a uniform grid are checked*/
+			SWEEP_PRUNE_BROADPHASE /*!< Vehicles overlapping along a sorted axis are checked, for corridors*/
+		};
+
 		int m_Boundary[4]; /*!< Boundary coordinates of the observation area: 0: minX; 1: minY; 2: maxX; 3: maxY*/
 
 		/** Initialize SSAM analysis parameters.
@@ -325,9 +482,50 @@ namespace SSAMFuncs
 		 */
 		SSAMFUNCSDLL_API void SetVehicle(SP_Vehicle pVeh);
 
+		/** Add a vehicle to the current time step without copying it.
+		 * SSAM takes over the vehicle and links it to the vehicle of the next time step,
+		 * so the caller must not use or modify the vehicle any more.
+		 * @param pVeh smart pointer to a vehicle as input value
+		 */
+		SSAMFUNCSDLL_API void AdoptVehicle(SP_Vehicle pVeh);
+
+		/** Add a contiguous array of vehicles to the current time step.
+		 * Each vehicle is copied once, and the array is not used after the call.
+		 * @param vehicles pointer to the first vehicle
+		 * @param n number of vehicles
+		 */
+		SSAMFUNCSDLL_API void SetVehicles(const Vehicle* vehicles, size_t n);
+
+		/** Set a complete time step and run one step of SSAM analysis on it.
+		 * The vehicles are validated against the dimensions in one pass, and only the vehicles
+		 * inside the analysis area are built. Unlike SetTimeStep(), the step is analyzed
+		 * right away, without waiting for the next time step.
+		 * @param t time step
+		 * @param vehicles pointer to the first vehicle state
+		 * @param n number of vehicles
+		 */
+		SSAMFUNCSDLL_API void SetTimeStepVehicles(float t, const VehicleState* vehicles, size_t n);
+
 		/** Calculate summary on safety measures of all conflicts
 		 */
 		SSAMFUNCSDLL_API void CalcSummaries();
+
+		/** Call a function on each kept conflict, in the order of the conflict list.
+		 * With a conflict memory budget, the conflicts are read back from the store,
+		 * and a spilled conflict is valid during the call only.
+		 * @param f function to call
+		 */
+		SSAMFUNCSDLL_API void ForEachConflict(const std::function<void(const Conflict&)>& f);
+
+		/** Build the time step index of a TRJ file and save it to the sidecar index file.
+		 * @param trjFileName name of the TRJ file
+		 */
+		SSAMFUNCSDLL_API void BuildTrjIndex(const std::string& trjFileName);
+
+		/** Convert a TRJ file into a columnar cache file, which later analyses of the TRJ file read instead.
+		 * @param trjFileName name of the TRJ file
+		 */
+		SSAMFUNCSDLL_API void BuildTrjCache(const std::string& trjFileName);
 		
 		//	Get()/Set() methods
 		void SetMaxTTC(float maxTTC) { m_MaxTTC = maxTTC; }
@@ -337,17 +535,69 @@ namespace SSAMFuncs
 		void SetCSVFile(const std::string& s) { m_CsvFileName = s; }
 		void SetNThreads(int n) {m_NThreads = n;}
 		void SetIsCalcPUEA(bool isCalcPUEA) {m_IsCalcPUEA = isCalcPUEA;}
+		void SetTTCEngine(int engine) {m_TTCEngine = engine;}
+		void SetBroadphase(int broadphase) {m_Broadphase = broadphase;}
 		void SetPrintProgess(bool b) {m_IsPrintProgress = b;}
 		void SetWriteDat(bool b) { m_IsWriteDat = b;}
+		void SetPrefetchDepth(int n) { m_PrefetchDepth = n; }
+		void SetNFileWorkers(int n) { m_NFileWorkers = n; }
+		void SetNTimeSlices(int n) { m_NTimeSlices = n; }
+		void SetUseIndex(bool b) { m_IsUseIndex = b; }
+		void SetUseCache(bool b) { m_IsUseCache = b; }
+
+		/** Register a sink that receives each conflict as soon as its event is finished.
+		 * The sink is called on the analysis thread; wrap it in an AsyncConflictSink to write on a dedicated thread.
+		 * Conflicts of time slices and of concurrently analyzed files are delivered when the slice or file is merged.
+		 * @param pSink smart pointer to the sink, NULL to remove the sink
+		 */
+		void SetConflictSink(SP_ConflictSink pSink) { m_pConflictSink = pSink; }
+
+		/** Set whether to keep the conflicts in the conflict list.
+		 * Without the list the summaries are still calculated, but ExportResults() has nothing to export.
+		 * @param b false to pass the conflicts only to the conflict sink
+		 */
+		void SetRetainConflicts(bool b) { m_IsRetainConflicts = b; }
+
+		/** Keep the conflicts in a store that spills them to a file above a memory budget.
+		 * The conflict list stays empty; use ForEachConflict() to iterate the conflicts.
+		 * @param bytes maximum number of bytes of the conflicts kept in memory, 0 to keep all conflicts in the conflict list
+		 */
+		void SetConflictMemoryBudget(size_t bytes) { m_ConflictStore.SetMemoryBudget(bytes); }
+
+		/** Set the name of the file the conflicts above the memory budget are spilled to.
+		 * @param s name of the spill file, removed when the analysis object is destroyed
+		 */
+		void SetConflictSpillFile(const std::string& s) { m_ConflictStore.SetSpillFileName(s); }
+
+		/** Restrict the analysis to the conflict events that start in a time window.
+		 * The analysis starts MaxPET + MaxTTC seconds before the window to pick up the events in progress.
+		 * @param start start time of the window in seconds, -FLT_MAX for the beginning of file
+		 * @param end end time of the window in seconds, FLT_MAX for the end of file
+		 */
+		void SetTimeWindow(float start, float end) { m_WindowStart = start; m_WindowEnd = end; }
 		void AddTrjFile(const std::string& s) { m_TrjFileNames.push_back(s); }
 		void AddTrjDataList(const std::string& s, std::list<TrjRecord>* trjDataList) 
 		{
 			m_TrjDataLists.push_back(TrjDataList(s, trjDataList));
 		}
 
+		/** Add a TRJ data list that SSAM takes over. The records are moved, not copied,
+		 * their vehicles are analyzed without copying, and each record is released once it is analyzed.
+		 * @param s name of TRJ data source
+		 * @param trjDataList the TRJ records, left empty
+		 */
+		void AddTrjDataList(const std::string& s, std::list<TrjRecord>&& trjDataList)
+		{
+			m_OwnedTrjDataLists.push_back(std::list<TrjRecord>());
+			m_OwnedTrjDataLists.back().swap(trjDataList);
+			m_TrjDataLists.push_back(TrjDataList(s, &m_OwnedTrjDataLists.back()));
+		}
+
 		float GetMaxTTC() { return m_MaxTTC; }
 		float GetMaxPET() { return m_MaxPET; }
 		bool GetIsCalcPUEA() { return m_IsCalcPUEA;}
+		int GetTTCEngine() const { return m_TTCEngine;}
+		int GetBroadphase() const { return m_Broadphase;}
 		int GetRearEndAngle() { return m_RearEndAngleThreshold;}
 		int GetCrossingAngle() { return m_CrossingAngleThreshold;}
 		int GetUnits(){ return m_Units; }
@@ -357,6 +607,63 @@ namespace SSAMFuncs
 		SP_Summary GetSummary() const {return m_pSummary;}
 		int GetAnalysisTime() const { return m_AnalysisTime; }
 		const std::list<std::string>& GetTrjFileNames() const {return m_TrjFileNames;}
+		int GetPrefetchDepth() const { return m_PrefetchDepth; }
+		int GetNFileWorkers() const { return m_NFileWorkers; }
+		int GetNTimeSlices() const { return m_NTimeSlices; }
+		bool GetUseIndex() const { return m_IsUseIndex; }
+		bool GetUseCache() const { return m_IsUseCache; }
+		SP_ConflictSink GetConflictSink() const { return m_pConflictSink; }
+		bool GetRetainConflicts() const { return m_IsRetainConflicts; }
+		size_t GetConflictMemoryBudget() const { return m_ConflictStore.GetMemoryBudget(); }
+		const std::string& GetConflictSpillFile() const { return m_ConflictStore.GetSpillFileName(); }
+		size_t GetNSpilledConflicts() const { return m_ConflictStore.GetNSpilled(); }
+
+		/** Get the number of kept conflicts.
+		 * @return number of conflicts in the conflict list or in the conflict store
+		 */
+		size_t GetNConflicts() const { return IsConflictListed() ? m_ConflictList.size() : m_ConflictStore.GetSize(); }
+		float GetWindowStart() const { return m_WindowStart; }
+		float GetWindowEnd() const { return m_WindowEnd; }
+		long long GetReadBytes() const { return m_ReadBytes; }
+		double GetReadSeconds() const { return m_ReadSeconds; }
+
+		/** Get the decoding throughput of TRJ files.
+		 * @return bytes decoded per second
+		 */
+		double GetReadThroughput() const { return (m_ReadSeconds > 0) ? m_ReadBytes / m_ReadSeconds : 0; }
+
+		/** Get the number of vehicles that entered the analysis, counted as the time steps are linked.
+		 * A vehicle entering again after a gap is counted again. Time-sliced analyses are not counted.
+		 * @return number of vehicles
+		 */
+		long long GetNEnteredVehicles() const { return m_NEnteredVehicles; }
+
+		/** Get the number of vehicles that left the analysis, counted as the time steps are linked.
+		 * @return number of vehicles
+		 */
+		long long GetNLeftVehicles() const { return m_NLeftVehicles; }
+
+		/** Get the number of vehicle projections of the events found in the projection cache.
+		 * @return number of projections
+		 */
+		long long GetNProjectionHits() const { return m_ProjectionCache.GetNHits(); }
+
+		/** Get the number of vehicle projections of the events calculated on request.
+		 * @return number of projections
+		 */
+		long long GetNProjectionMisses() const { return m_ProjectionCache.GetNMisses(); }
+
+		/** Get the number of vehicles allocated in the arenas of the time steps.
+		 * @return number of vehicles
+		 */
+		long long GetNArenaVehicles() const { return m_VehiclePool.GetNVehicles(); }
+
+		/** Get the number of vehicle blocks allocated from the heap by the arenas of the time steps.
+		 * @return number of blocks
+		 */
+		long long GetNArenaBlocks() const { return m_VehiclePool.GetNBlocks(); }
+		long long GetNArenas() const { return m_VehiclePool.GetNArenas(); }
+		long long GetNArenaReuses() const { return m_VehiclePool.GetNReuses(); }
 	protected:
 		float m_MaxTTC; /*!< Max TTC threshold */
 		float m_MaxPET; /*!< Max PET threshold */
@@ -366,30 +673,96 @@ namespace SSAMFuncs
 		int m_StartTime; /*!< Start time for analysis */
 		int m_EndTime; /*!< End time for analysis */
 		std::list<std::string> m_TrjFileNames; /*!< A list of TRJ files to analyze */
-		std::map<VehiclePair, SP_Event> m_EventList; /*!< List of detected conflict events */
+		EventTable m_EventList; /*!< Table of detected conflict events by vehicle pair */
 		std::list<SP_Conflict> m_ConflictList; /*!< List of smart pointers to conflict points */
 		/*!< A map container stores conflict smart pointers using TRJ source names as keys*/
 		std::map<std::string, std::list<SP_Conflict> > m_FileToConflictsMap; 
 		SP_Summary m_pSummary; /*!< Smart pointer to the summary over all TRJ inputs */
 		std::list<SP_Summary> m_Summaries; /*!< A list of summary smart pointers, each for one TRJ source */
+		SP_ConflictSink m_pConflictSink; /*!< Smart pointer to the sink receiving each conflict as it is found */
+		SP_Summary m_pStreamSummary; /*!< Summary over all TRJ inputs updated as conflicts are found, if conflicts are not in the conflict list */
+		std::map<std::string, SP_Summary> m_StreamSummaries; /*!< Summaries of TRJ sources updated as conflicts are found, if conflicts are not in the conflict list */
+		ConflictStore m_ConflictStore; /*!< Conflicts kept within a memory budget instead of the conflict list */
 		bool m_IsCalcPUEA; /*!< Flag to indicate whether to calculate P(UEA), mTTC, mPET */
+		int m_TTCEngine; /*!< Method to find the TTC of a conflict event, one of Event::TTC_ENGINE */
+		int m_Broadphase; /*!< Method to find the pairs of vehicles crashing in a time step, one of BROADPHASE */
+		bool m_IsRetainConflicts; /*!< Flag to indicate whether to keep the conflicts in the conflict list */
 		std::string m_CsvFileName; /*!< A csv file to output analysis results */
 	private:
+		/** FinishedEvent is a conflict event finished in the time step being analyzed
+		*/
+		struct FinishedEvent
+		{
+			int m_Position; /*!< Position of the event in the order of the event table */
+			SP_Conflict m_pConflict; /*!< Smart pointer to the conflict of the event, NULL if the event is not a conflict */
+		};
+
+		/** EventBuffer keeps the events finished by one thread analyzing the events of a time step
+		*/
+		struct EventBuffer
+		{
+			std::vector<FinishedEvent> m_Finished; /*!< Events finished by the thread, in the order of the event table */
+			std::exception_ptr m_pError; /*!< Error thrown by the first event failed on the thread, if any */
+			int m_ErrorPosition; /*!< Position of the event that failed in the order of the event table */
+		};
+
+		const static int MIN_PARALLEL_EVENTS = 32; /*!< Minimum number of open events to analyze them in parallel */
+
 		std::string m_TrjSrcName; /*!< Name of TRJ data source */
-		std::ifstream m_TrjFile; /*!< A TRJ file to analyze */
+		TrjReader m_TrjReader; /*!< A memory-mapped TRJ file to analyze */
+		long long m_ReadBytes; /*!< Number of bytes decoded from TRJ files */
+		double m_ReadSeconds; /*!< Time in seconds spent decoding TRJ files */
+		long long m_NEnteredVehicles; /*!< Number of vehicles not in the previous time step of their time step */
+		long long m_NLeftVehicles; /*!< Number of vehicles not in the next time step of their time step */
+		VehiclePool m_VehiclePool; /*!< Arenas of the vehicles of the time steps, recycled as time steps leave the analysis window */
 		std::list<TrjDataList> m_TrjDataLists; /*!< A list of TRJ data lists to analyze */
-		std::list<TrjRecord> m_TrjDataList; /*!< A TRJ data lists to analyze */
+		std::list<std::list<TrjRecord> > m_OwnedTrjDataLists; /*!< TRJ data lists taken over from the caller */
+		const std::list<TrjRecord>* m_pTrjDataList; /*!< The TRJ data list being analyzed */
 		bool m_IsWriteDat; /*!< Flag indicates whether to write input TRJ records to a csv file */
 		std::ofstream m_DatFile; /*!< A csv file to write input TRJ records */
 		int m_NThreads;  /*!< Number of threads to use */
+		int m_PrefetchDepth; /*!< Number of time steps a reader thread decodes ahead of the analysis, 0 to read inline */
+		int m_NFileWorkers; /*!< Number of TRJ files to analyze concurrently */
+		int m_NTimeSlices; /*!< Number of time slices of one TRJ file to analyze concurrently */
+		float m_SlicePrevTimeStep; /*!< Time step before the first time step of a time slice, -FLT_MAX if the slice starts at the beginning of file */
+		float m_SliceEndTime; /*!< Time step from which a time slice creates no new conflict events */
+		bool m_IsRecordEvents; /*!< Flag to indicate whether to record the span of finished conflict events */
+		std::vector<EventRecord> m_EventRecords; /*!< Spans of the finished conflict events */
+		std::map<VehiclePair, float> m_BlockedPairs; /*!< Vehicle pairs that create no new conflict event up to the mapped time step */
+		std::set<VehiclePair> m_PairFilter; /*!< Vehicle pairs to analyze, all pairs if empty */
+		std::set<int> m_VehicleFilter; /*!< Vehicles to analyze, all vehicles if empty */
+		float m_WindowStart; /*!< Start time of the analysis window */
+		float m_WindowEnd; /*!< End time of the analysis window */
+		bool m_IsUseIndex; /*!< Flag to indicate whether to load and save the sidecar index files of TRJ files */
+		bool m_IsBuildIndex; /*!< Flag to indicate whether to build the index of the current TRJ file while reading it */
+		TrjIndex m_ReadIndex; /*!< Index built while reading the current TRJ file */
+		bool m_IsUseCache; /*!< Flag to indicate whether to read the columnar cache file of a TRJ file if it is up to date */
+		TrjCache m_TrjCache; /*!< The columnar cache of the current TRJ file, if it is read instead of the TRJ file */
+		size_t m_CacheStep; /*!< Index of the next time step to read from the cache */
 		SP_ZoneGrid m_pZoneGrid;  /*!< Smart pointer to the zone grid object */
+		SP_SweepPrune m_pSweepPrune; /*!< Smart pointer to the sweep and prune object, if it is the broadphase */
+		int m_SweepAxis; /*!< Axis of the sweep reported last for the current TRJ file, -1 if none */
+		ProjectionCache m_ProjectionCache; /*!< Projections of the vehicles of the time step being analyzed, shared by the zone grid and the events of the first thread */
+		std::vector<std::shared_ptr<ProjectionCache> > m_EventCaches; /*!< Projections of the vehicles of the time step being analyzed for the events of each other thread */
+		std::vector<EventBuffer> m_EventBuffers; /*!< Buffers of the threads analyzing the events */
+		std::vector<FinishedEvent> m_FinishedEvents; /*!< Events finished in the time step being analyzed, merged from the threads */
 		float m_Units; /*!< Engligh or Metric units */
 		float m_ZoneSize; /*!< Size of one zone */
+		int m_BaseZoneSize; /*!< Size of one zone for the units of the analysis area, from which the zone size is tuned */
+		int m_NStepsToTuneZones; /*!< Number of time steps to analyze before the zone size is tuned again */
+		int m_NZoneTunings; /*!< Number of times the zone size is tuned for the current TRJ file */
 		float m_ReadTimeStep; /*!< Current time step read from TRJ source*/
 		float m_AnalysisTimeStep; /*!< Current time step to run SSAM analysis*/
 		InputFormat m_Format; /*!< TRJ format */
 		SP_Dimensions m_pDimensions; /*!< Smart pointer to the dimensions of analysis area */
-		std::list<SP_TimeStepData> m_StepDataList; /*!< Current list of time step data to run SSAM analysis */
+		/*!< Time steps of the analysis window, from the time step being analyzed to the last time step read.
+		 * A vehicle refers to its data in the next time step by index, so a time step is kept while it is in the window only,
+		 * and the events keep copies of the vehicle data they need. */
+		std::deque<SP_TimeStepData> m_StepDataList;
+		StepWindow m_StepWindow; /*!< Vehicles of the time steps of the analysis window, set for the time step being analyzed */
+		std::vector<int> m_GridVehicles; /*!< Indexes of the vehicles of the time step being analyzed added to the broadphase */
+		std::vector<std::pair<int, int> > m_GridCrashes; /*!< Pairs of indexes of the vehicles of the time step being analyzed found crashing by the broadphase */
+		VehicleTracks m_VehicleTracks; /*!< Tracks of the vehicles in the analysis window */
 		SP_TimeStepData m_pCurStep; /*!< Current time step data to run SSAM analysis */
 		bool m_IsFirstTimeStep; /*!< Flag to indicate whether the current read time step is the first time step */
 		int m_NSteps; /*!< Number of steps per second for motion prediction analysis */
@@ -404,6 +777,128 @@ namespace SSAMFuncs
 		 */
 		void Analyze(const std::list<TrjDataList>& trjDataLists);
 
+		/** Check whether a TRJ data list is taken over from the caller.
+		 * @param pTrjDataList pointer to the TRJ data list
+		 * @return true if SSAM owns the list
+		 */
+		bool IsOwnedTrjDataList(const std::list<TrjRecord>* pTrjDataList) const;
+
+		/** Remove the analyzed TRJ data lists taken over from the caller.
+		 */
+		void ReleaseOwnedTrjDataLists();
+
+		/** Run SSAM analysis on one TRJ file.
+		 * @param trjFileName name of the TRJ file
+		 */
+		void AnalyzeTrjFile(const std::string& trjFileName);
+
+		/** Open a TRJ file and read its header records.
+		 * @param trjFileName name of the TRJ file
+		 */
+		void OpenTrjFile(const std::string& trjFileName);
+
+		/** Close the current TRJ file and its cache.
+		 */
+		void CloseTrjFile()
+		{
+			m_TrjReader.Close();
+			m_TrjCache.Close();
+		}
+
+		/** Get the read position in the current TRJ file.
+		 * @return offset of the next record to read
+		 */
+		long long GetTrjPosition() const;
+
+		/** Move the read position in the current TRJ file.
+		 * @param offset offset of a TIMESTEP record
+		 */
+		void SeekTrjPosition(long long offset);
+
+		/** Reset the time step state before the first time step of a TRJ source.
+		 */
+		void ResetTimeSteps();
+
+		/** Load the time step index of the current TRJ file from its sidecar file,
+		 * or build it by scanning the file.
+		 * @param index the time step index as output value
+		 */
+		void GetTrjIndex(TrjIndex& index);
+
+		/** Save the time step index of the current TRJ file to its sidecar file.
+		 * @param index the time step index
+		 */
+		void SaveTrjIndex(const TrjIndex& index);
+
+		/** Split a range of time steps of the current TRJ file at time step boundaries
+		 * and analyze the time slices concurrently.
+		 * Each slice only creates conflict events at its own time steps, and keeps analyzing
+		 * past its end until those events are finished. The events of each slice are then
+		 * stitched to the events of the previous slices: an event of a vehicle pair that was
+		 * still open in the previous slice at the start of this slice is dropped, and the pair
+		 * is analyzed again from the time its open event finished. The conflict list is the same
+		 * as the serial analysis of the range.
+		 * @param index time step index of the TRJ file
+		 * @param firstStep index of the first time step to analyze
+		 * @param endStep index of the first time step after the range
+		 * @param reportTime conflicts of the events created before this time are not reported
+		 * @param nSlices number of time slices
+		 */
+		void AnalyzeTrjFileSliced(const TrjIndex& index, size_t firstStep, size_t endStep, float reportTime, int nSlices);
+
+		/** Run SSAM analysis on one time slice of a TRJ file.
+		 * @param index time step index of the TRJ file
+		 * @param firstStep index of the first time step of the slice
+		 * @param endStep index of the first time step after the slice
+		 * @param blockedPairs vehicle pairs that create no new conflict event up to the mapped time step
+		 * @param pairFilter vehicle pairs to analyze, all pairs if empty
+		 * @return smart pointer to the SSAM object that analyzed the slice, with the recorded events
+		 */
+		std::shared_ptr<SSAM> AnalyzeTimeSlice(const TrjIndex& index, size_t firstStep, size_t endStep,
+			const std::map<VehiclePair, float>& blockedPairs, const std::set<VehiclePair>& pairFilter) const;
+
+		/** Read and analyze the time steps of a TRJ file from an offset, as a time slice.
+		 * @param trjFileName name of the TRJ file
+		 * @param offset offset of the first TIMESTEP record of the slice
+		 */
+		void AnalyzeTrjSlice(const std::string& trjFileName, long long offset);
+
+		/** Check whether a time slice has finished all conflict events it created.
+		 * @return true if the analysis is past the end of the slice and no event is open
+		 */
+		bool IsSliceDrained() const { return m_AnalysisTimeStep >= m_SliceEndTime && m_EventList.IsEmpty(); }
+
+		/** Check whether a new conflict event may be created for a pair of vehicles at the current analysis time step.
+		 * @param vehPair IDs of the pair of vehicles
+		 * @return true if the event may be created
+		 */
+		bool IsEventAllowed(const VehiclePair& vehPair) const;
+
+		/** Record the span of a finished conflict event.
+		 * @param vehPair IDs of the pair of vehicles
+		 * @param e smart pointer to the conflict event
+		 * @param lastTimeStep time step at which the event is finished
+		 * @param c smart pointer to the conflict of the event, NULL if the event is not a conflict
+		 */
+		void RecordEvent(const VehiclePair& vehPair, SP_Event e, float lastTimeStep, SP_Conflict c);
+
+		/** Run SSAM analysis on TRJ files concurrently, each file on its own SSAM object,
+		 * and merge the results in the order of the file list.
+		 * @param trjFileNames names of the TRJ files
+		 */
+		void AnalyzeTrjFilesParallel(const std::vector<std::string>& trjFileNames);
+
+		/** Create an SSAM object with the analysis parameters of this object
+		 * to analyze one TRJ file.
+		 * @return smart pointer to the new SSAM object
+		 */
+		std::shared_ptr<SSAM> CreateFileWorker() const;
+
+		/** Merge the results of an SSAM object that analyzed one TRJ file.
+		 * @param worker the SSAM object to merge
+		 */
+		void MergeFileWorker(const SSAM& worker);
+
 		/** Read the size of TRJ source: bytes for TRJ file, and records for TRJ data list.
 		 */
 		void ReadTrjInputSize();
@@ -420,20 +915,59 @@ namespace SSAMFuncs
 		 */
 		void ApplyDimensions();
 
+		/** Read a time step record and all following vehicle records from TRJ file.
+		 * @param pStep smart pointer to the time step data as output value
+		 * @return false if the end of TRJ file is reached
+		 */
+		bool ReadTimeStep(SP_TimeStepData& pStep);
+
+		/** Read and analyze all time steps of the current TRJ file on this thread.
+		 * @return time in seconds spent decoding
+		 */
+		double AnalyzeTimeSteps();
+
+		/** Read all time steps of the current TRJ file on a reader thread
+		 * and analyze them on this thread as they arrive.
+		 * @return time in seconds spent decoding
+		 */
+		double AnalyzeTimeStepsPrefetched();
+
+		/** Read a time step and its vehicles from the cache of the TRJ file.
+		 * @param pStep smart pointer to the time step data as output value
+		 * @return false if the last time step is read
+		 */
+		bool ReadCachedTimeStep(SP_TimeStepData& pStep);
+
 		/** Read a vehicle from TRJ file.
-		 * @param pVeh smart pointer to a vehicle as output value
+		 * @param v a vehicle as output value
+		 */
+		void ReadVehicle(Vehicle& v);
+
+		/** Copy a vehicle into the arena of the current time step, and add it if it is valid.
+		 * @param veh the vehicle to copy
 		 */
-		void ReadVehicle(SP_Vehicle pVeh);
+		void CopyVehicle(const Vehicle& veh);
+
+		/** Run one step of SSAM analysis on a complete time step.
+		 * @param pStep smart pointer to the time step data
+		 */
+		void AnalyzeTimeStep(SP_TimeStepData pStep);
+
+		/** Print the decoding throughput of the current TRJ file.
+		 * @param nBytes number of bytes decoded
+		 * @param seconds time in seconds spent decoding
+		 */
+		void PrintReadThroughput(long long nBytes, double seconds);
 		
 		/** Validate current TRJ format.
 		 */
 		void ValidateInputFormat();
 
 		/** Validate a vehicle.
-		 * @param pVeh smart pointer to a vehicle to validate
+		 * @param v the vehicle to validate
 		 * @return true if intput is valid vehicle data.
 		 */
-		bool ValidateVehicle(SP_Vehicle pVeh);
+		bool ValidateVehicle(const Vehicle& v);
 
 		/** Print a read time step to csv file.
 		 */
@@ -451,93 +985,27 @@ namespace SSAMFuncs
 
 		/** Detect conflicts in the current step of vehicles.
 		 * @param pZoneGrid smart pointer to the zone grid
-		 * @param eventList a map container stores conflict events using vehicle pairs as keys 
+		 * @param eventList table of the open conflict events by vehicle pair
 		 */
-		void DetectConflicts(SP_ZoneGrid pZoneGrid, std::map<VehiclePair, SP_Event>& eventList);
+		void DetectConflicts(SP_ZoneGrid pZoneGrid, EventTable& eventList);
 
-		/** Analyze conflicts detected in the current step.
+		/** Analyze conflicts detected in the current step, the events in parallel.
+		 * The finished events are removed and their conflicts created in the order of the vehicle pairs.
 		 * @param trjSrcName name of TRJ source
-		 * @param eventList a map container stores smart pointers to conflict events using vehicle pairs as keys 
+		 * @param eventList table of the open conflict events by vehicle pair
 		 */
-		void AnalyzEvents(const std::string& trjSrcName, std::map<VehiclePair, SP_Event>& eventList);
-		
-		/** Create a conflict record.
-		 * @param e smart pointer to the conflict event for creating conflict record
-		 * @param trjSrcName name of TRJ source
-		 */
-		void CreateConflict(SP_Event e, const std::string& trjSrcName)
-		{
-			SP_Conflict c  = std::make_shared<Conflict>(e, trjSrcName);
-			m_ConflictList.push_back(c); 
-			m_FileToConflictsMap[trjSrcName].push_back(c);
-		}
-		
-		//////////////////////////////////////////
-		// parse values from a binary file
-		const static int INT_SIZE = sizeof(int);
-		char m_BufferInt[INT_SIZE];
-		const static int FLOAT_SIZE = sizeof(float);
-		char m_BufferFloat[FLOAT_SIZE];
-
-		/** Read a byte from binaray file.
-		 * @param in the input stream
-		 * @return byte value
-		 */
-		char ReadByte(std::ifstream& in)
-		{
-			char x;
-			if (!in.get(x))
-				throw SSAMException("file reading failed");
-			return x;
-		}
-
-		/** Read a float number from binaray file.
-		 * @param in the input stream
-		 * @return float value
-		 */
-		float ReadFloat(std::ifstream& in)
-		{
-			float x = 0.0;
-			if (!in.read( m_BufferFloat, FLOAT_SIZE))
-				throw SSAMException("file reading failed");
-			if (m_Format.m_Endian == 'B')
-			{
-				ConvertEndianness(m_BufferFloat, FLOAT_SIZE);
-			}
-			memcpy(&x, &m_BufferFloat, FLOAT_SIZE);
-			return x;
-		}
+		void AnalyzEvents(const std::string& trjSrcName, EventTable& eventList);
 
-		/** Read an integer number from binaray file.
-		 * @param in the input stream
-		 * @return int value
+		/** Pass a conflict to the conflict list, the summaries and the conflict sink.
+		 * @param c smart pointer to the conflict
+		 * @param trjSrcName name of TRJ source
 		 */
-		int ReadInt(std::ifstream& in)
-		{
-			int x = 0;
-			if (!in.read( m_BufferInt, INT_SIZE))
-				throw SSAMException("file reading failed");
-			if (m_Format.m_Endian == 'B')
-			{
-				ConvertEndianness(m_BufferInt, INT_SIZE);
-			}
-			memcpy(&x, &m_BufferInt, INT_SIZE);
-			return x;
-		}
+		void EmitConflict(SP_Conflict c, const std::string& trjSrcName);
 
-		/** Convert the endianness from Big Endian to Little Endian.
-		 * @param buffer a char array stores the value
-		 * @param size size of the buffer
+		/** Check whether the kept conflicts are in the conflict list, rather than in the conflict store.
+		 * @return true if the conflicts are kept without a memory budget
 		 */
-		void ConvertEndianness(char* buffer, int size)
-		{
-			for (int i = 0; i < size/2; ++i)
-			{
-				char tmp = buffer[i];
-				buffer[i] = buffer[size - i];
-				buffer[size - i] = tmp;
-			}
-		}
+		bool IsConflictListed() const { return m_IsRetainConflicts && m_ConflictStore.GetMemoryBudget() == 0; }
 	};
 	/** Smart pointer type to SSAM class.
       */
@@ -36,10 +36,20 @@
 class SSAMFUNCSDLL_API Summary
 {
 public:
-	Summary(){}
+	Summary() : m_NConflicts(0) {}
 	~Summary(){}
 	Summary(const std::string& trjFile, const std::list<SP_Conflict>& conflictList);
 
+	/** Create an empty summary that is updated one conflict at a time.
+	 * @param trjFile name of the summary group
+	 */
+	explicit Summary(const std::string& trjFile) : m_TrjFile(trjFile), m_NConflicts(0) {}
+
+	/** Update the summary with a conflict.
+	 * @param c the conflict to add
+	 */
+	void AddConflict(const Conflict& c);
+
 	static const int NUM_SUMMARY_LABELS = 6; /*!< The number of summary labels */
 	const static std::string SUMMARY_LABEL[NUM_SUMMARY_LABELS]; /*!< Strings represent summary labels*/
 
@@ -49,6 +59,7 @@ public:
 	const std::vector<float>& GetMeanVals() const {return m_MeanVals;}
 	const std::vector<float>& GetVarVals() const {return m_VarVals;}
 	const std::vector<int>& GetConflictTypeCounts() const {return m_ConflictCounts;}
+	bool IsEmpty() const {return m_NConflicts == 0;}
 private:
 	std::string m_TrjFile; /*!< The name of the trajectory file where the conflicts are identified */
 	std::vector<float> m_MinVals; /*!< The minimum values of summarized safety measures */
@@ -61,6 +72,7 @@ private:
      * The last element is the total number of conflicts 
      */
 	std::vector<int> m_ConflictCounts; 
+	int m_NConflicts; /*!< The number of summarized conflicts */
 };
 
 /** Smart pointer type to Summary class.
@@ -0,0 +1,139 @@
+/*------------------------------------------------------------------------------
+   Copyright  2016-2017
+   New Global Systems for Intelligent Transportation Management Corp.
+
+   This file is part of SSAM.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Affero General Public License as
+   published by the Free Software Foundation, either version 3 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------------*/
+#pragma once
+#ifndef SWEEPPRUNE_H
+#define SWEEPPRUNE_H
+
+#include <vector>
+#include "INCLUDE.h"
+#include "Vehicle.h"
+
+/** SweepPrune finds the crashes of the vehicles of a time step by sorting the footprints along one axis
+  * and sweeping the sorted footprints: a footprint is checked only against the footprints that start
+  * before it ends along the axis and overlap it along the other axis.
+  * The axis is the one along which the footprints are shorter for the spread of the vehicles, so that a
+  * corridor is swept along its length. The vehicles barely reorder between time steps, so the order of a
+  * time step is carried to the next by the index of each vehicle in the next time step, and sorted again
+  * by insertion; only the vehicles entering the area are sorted from scratch.
+*/
+class SweepPrune
+{
+public:
+	/** SWEEP_AXIS enumerates the axes along which the footprints are sorted
+	*/
+	enum SWEEP_AXIS
+	{
+		X_AXIS, /*!< Sorted along x-axis*/
+		Y_AXIS /*!< Sorted along y-axis*/
+	};
+
+	SweepPrune();
+
+	/** Constructor creates the SweepPrune for an analysis area
+	 * @param xMin Left edge of the area
+	 * @param yMin Bottom edge of the area
+	 * @param xMax Right edge of the area
+	 * @param yMax Top edge of the area
+	 */
+	SweepPrune(int xMin, int yMin, int xMax, int yMax);
+
+	~SweepPrune(){}
+
+	/** Reset the SweepPrune for an analysis area, forgetting the order of the previous time step
+	 * @param xMin Left edge of the area
+	 * @param yMin Bottom edge of the area
+	 * @param xMax Right edge of the area
+	 * @param yMax Top edge of the area
+	 */
+	void ResetArea(int xMin, int yMin, int xMax, int yMax);
+
+	/**
+	 * Sort the vehicles of a time step, starting from the order carried from the previous time step.
+	 * A vehicle with the center outside the analysis area is not added.
+	 * @param shapes footprints of the vehicles
+	 * @param vehicles indexes of the footprints of the vehicles to add, in increasing order
+	 */
+	void Build(const VehicleShapes& shapes, const std::vector<int>& vehicles);
+
+	/**
+	 * Find the pairs of vehicles added that crash with each other, in parallel.
+	 * @param shapes footprints of the vehicles added
+	 * @param crashes output pairs of footprint indexes, the lower index first, each pair once, in increasing order
+	 */
+	void FindCrashes(const VehicleShapes& shapes, std::vector<std::pair<int, int> >& crashes);
+
+	/**
+	 * Carry the order of the vehicles to the next time step. A vehicle not in the next time step is dropped.
+	 * @param step vehicles of the time step, by footprint index, linked to the next time step
+	 */
+	void CarryOrder(const StepVehicles& step);
+
+	int GetAxis() const { return m_Axis; }
+	int GetNFullSorts() const { return m_NFullSorts; }
+
+private:
+	/** CrashBuffer keeps the pairs checked and found by one thread finding crashes
+	*/
+	struct CrashBuffer
+	{
+		std::vector<std::pair<int, int> > m_Overlaps; /*!< Pairs of vehicles overlapping along both axes, the higher index first */
+		std::vector<int> m_Found; /*!< Vehicles found crashing with a vehicle */
+		std::vector<std::pair<int, int> > m_Crashes; /*!< Pairs of vehicles found crashing by the thread */
+	};
+
+	int m_AreaMinX; /*!< Left edge of the analysis area */
+	int m_AreaMinY; /*!< Bottom edge of the analysis area */
+	int m_AreaMaxX; /*!< Right edge of the analysis area */
+	int m_AreaMaxY; /*!< Top edge of the analysis area */
+	int m_Axis; /*!< Axis along which the vehicles are sorted, one of SWEEP_AXIS */
+	int m_NFullSorts; /*!< Number of time steps in which the carried order was too far from sorted and the vehicles were sorted from scratch */
+	std::vector<int> m_Order; /*!< Footprint indexes of the vehicles added, sorted by the start of the footprints along the axis */
+	std::vector<char> m_Marks; /*!< State of each footprint index while building: 0 not added, 1 added, 2 placed in the order */
+	std::vector<float> m_Keys; /*!< Start of the footprint along the axis, by footprint index */
+	std::vector<float> m_MinKeys; /*!< Start of the footprints along the axis, by position in the order */
+	std::vector<float> m_MaxKeys; /*!< End of the footprints along the axis, by position in the order */
+	std::vector<float> m_CrossMins; /*!< Start of the footprints along the other axis, by position in the order */
+	std::vector<float> m_CrossMaxs; /*!< End of the footprints along the other axis, by position in the order */
+	std::vector<int> m_CandidateStarts; /*!< Start of the candidates of each footprint index in m_Candidates, and the end of the last */
+	std::vector<int> m_Candidates; /*!< Lower footprint indexes overlapping each footprint along both axes */
+	std::vector<CrashBuffer> m_CrashBuffers; /*!< Buffers of the threads finding crashes */
+
+	/**
+	 * Choose the axis to sort along for the footprints added.
+	 * @param shapes footprints of the vehicles
+	 * @param vehicles indexes of the footprints of the vehicles
+	 * @return the axis, one of SWEEP_AXIS
+	 */
+	int ChooseAxis(const VehicleShapes& shapes, const std::vector<int>& vehicles) const;
+
+	/**
+	 * Sort a range of the order by insertion, giving up if the range is too far from sorted.
+	 * @param first start of the range
+	 * @param last end of the range
+	 * @return false if the range is not sorted
+	 */
+	bool InsertionSort(int first, int last);
+};
+
+/** Smart pointer type to SweepPrune class.
+*/
+typedef std::shared_ptr<SweepPrune> SP_SweepPrune;
+
+#endif
@@ -0,0 +1,53 @@
+/*------------------------------------------------------------------------------
+   Copyright  2016-2017
+   New Global Systems for Intelligent Transportation Management Corp.
+
+   This file is part of SSAM.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Affero General Public License as
+   published by the Free Software Foundation, either version 3 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------------*/
+#pragma once
+#ifndef TTCSOLVER_H
+#define TTCSOLVER_H
+#include <vector>
+#include "Vehicle.h"
+
+/** TTCSolver finds the first contact of two vehicles moving along their projected paths in continuous time.
+  * While both footprints move without turning, the gap of the footprints along each separating axis
+  * changes linearly with time, so the times the footprints overlap along all axes form one interval,
+  * found without stepping the TTC.
+*/
+class TTCSolver
+{
+public:
+	/** Find the earliest time at which the footprints of two projected paths intersect.
+	 * @param pathA pieces of the path of the first vehicle, in the order of time
+	 * @param pathB pieces of the path of the second vehicle, in the order of time
+	 * @param ttc output time of the first contact
+	 * @return true if the footprints intersect within the paths
+	 */
+	static bool FindFirstContact(const std::vector<PathPiece>& pathA, const std::vector<PathPiece>& pathB, float& ttc);
+
+private:
+	/** Find the earliest time at which the footprints of two pieces intersect.
+	 * @param a piece of the first path
+	 * @param b piece of the second path
+	 * @param startTime start of the time both pieces are valid
+	 * @param endTime end of the time both pieces are valid
+	 * @param ttc output time of the first contact
+	 * @return true if the footprints intersect between startTime and endTime
+	 */
+	static bool FindPieceContact(const PathPiece& a, const PathPiece& b, float startTime, float endTime, float& ttc);
+};
+#endif // TTCSOLVER_H
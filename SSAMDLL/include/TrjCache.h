@@ -0,0 +1,144 @@
+/*------------------------------------------------------------------------------
+   Copyright  2016-2017
+   New Global Systems for Intelligent Transportation Management Corp.
+
+   This file is part of SSAM.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Affero General Public License as
+   published by the Free Software Foundation, either version 3 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------------*/
+#pragma once
+#ifndef TRJCACHE_H
+#define TRJCACHE_H
+#include <string>
+#include "TrjReader.h"
+#include "TrjIndex.h"
+
+/** TrjCache is a columnar copy of a TRJ file for repeated analyses.
+  * The vehicles of each time step are stored as one block of arrays, one array
+  * per vehicle field, in native byte order, so that a memory-mapped block is used
+  * without decoding. The cache file is kept next to the TRJ file and is valid as long as
+  * the size and modification time of the TRJ file are unchanged.
+*/
+class TrjCache
+{
+public:
+	/** Header holds the header records of the TRJ file and the identity of the TRJ file
+	*/
+	struct Header
+	{
+		long long m_SourceSize; /*!< Size of the TRJ file in bytes */
+		long long m_SourceTime; /*!< Last modification time of the TRJ file */
+		char m_Endian; /*!< Byte endianness of the TRJ file */
+		float m_Version; /*!< TRJ file format version */
+		int m_ZOption; /*!< Flag to indicate whether to use z-value */
+		int m_Units; /*!< Engligh or Metric units */
+		float m_Scale; /*!< Distance per unit of X or Y */
+		int m_MinX; /*!< Left edge of the observation area */
+		int m_MinY; /*!< Bottom edge of the observation area */
+		int m_MaxX; /*!< Right edge of the observation area */
+		int m_MaxY; /*!< Top edge of the observation area */
+	};
+
+	/** Block points to the vehicle arrays of one time step
+	*/
+	struct Block
+	{
+		float m_TimeStep; /*!< Seconds since the start of the simulation */
+		int m_NVehicles; /*!< Number of vehicles */
+		const int* m_VehicleID; /*!< Vehicle IDs */
+		const int* m_LinkID; /*!< Link IDs */
+		const char* m_LaneID; /*!< Lane IDs */
+		const float* m_FrontX; /*!< X coordinates of the vehicle fronts */
+		const float* m_FrontY; /*!< Y coordinates of the vehicle fronts */
+		const float* m_RearX; /*!< X coordinates of the vehicle rears */
+		const float* m_RearY; /*!< Y coordinates of the vehicle rears */
+		const float* m_Length; /*!< Vehicle lengths */
+		const float* m_Width; /*!< Vehicle widths */
+		const float* m_Speed; /*!< Vehicle speeds */
+		const float* m_Acceleration; /*!< Vehicle accelerations */
+		const float* m_FrontZ; /*!< Z coordinates of the vehicle fronts, NULL before format version 1.05 */
+		const float* m_RearZ; /*!< Z coordinates of the vehicle rears, NULL before format version 1.05 */
+	};
+
+	TrjCache() {}
+	~TrjCache() {}
+
+	/** Open and map a cache file.
+	 * @param cacheFileName name of the cache file
+	 * @param sourceSize size of the TRJ file in bytes
+	 * @param sourceTime last modification time of the TRJ file
+	 * @return false if the cache file does not exist, is damaged, or was built from another version of the TRJ file
+	 */
+	bool Open(const std::string& cacheFileName, long long sourceSize, long long sourceTime);
+
+	/** Close the cache file.
+	 */
+	void Close()
+	{
+		m_File.Close();
+		m_Index.Clear();
+		m_BlockOffsets.clear();
+	}
+
+	/** Get the vehicle arrays of a time step.
+	 * The pointers stay valid until the next call of GetBlock() or Close().
+	 * @param i index of the time step
+	 * @return the block of the time step
+	 */
+	Block GetBlock(size_t i);
+
+	/** Find the time step of a TIMESTEP record of the TRJ file.
+	 * @param trjOffset offset of the TIMESTEP record in the TRJ file
+	 * @return index of the time step
+	 */
+	size_t FindStep(long long trjOffset) const;
+
+	/** Convert a TRJ file into a cache file.
+	 * @param cacheFileName name of the cache file
+	 * @param reader the TRJ reader of the TRJ file
+	 * @param index time step index of the TRJ file
+	 * @param header header records and identity of the TRJ file
+	 * @return false if the cache file could not be written
+	 */
+	static bool Write(const std::string& cacheFileName, TrjReader& reader, const TrjIndex& index, const Header& header);
+
+	/** Get the name of the cache file of a TRJ file.
+	 * @param trjFileName name of the TRJ file
+	 * @return name of the cache file
+	 */
+	static std::string GetCacheFileName(const std::string& trjFileName) { return trjFileName + ".ssc"; }
+
+	bool IsOpen() const { return m_File.IsOpen(); }
+	const Header& GetHeader() const { return m_Header; }
+	const TrjIndex& GetIndex() const { return m_Index; }
+	size_t GetNSteps() const { return m_Index.GetSize(); }
+private:
+	const static char MAGIC[8]; /*!< Leading bytes of a cache file, ending with the cache file version */
+	MappedFile m_File; /*!< The mapped cache file */
+	Header m_Header; /*!< Header records and identity of the TRJ file */
+	TrjIndex m_Index; /*!< Time step index of the TRJ file */
+	std::vector<long long> m_BlockOffsets; /*!< Offsets of the blocks in the cache file, one more than the time steps */
+
+	/** Get the size of the block of a time step.
+	 * @param nVehicles number of vehicles
+	 * @param hasZ flag to indicate whether the block has z coordinates
+	 * @return number of bytes, padded to 8 bytes
+	 */
+	static long long GetBlockSize(int nVehicles, bool hasZ);
+
+	TrjCache(const TrjCache&);
+	TrjCache& operator=(const TrjCache&);
+};
+
+#endif
@@ -0,0 +1,119 @@
+/*------------------------------------------------------------------------------
+   Copyright  2016-2017
+   New Global Systems for Intelligent Transportation Management Corp.
+
+   This file is part of SSAM.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Affero General Public License as
+   published by the Free Software Foundation, either version 3 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------------*/
+#pragma once
+#ifndef TRJINDEX_H
+#define TRJINDEX_H
+#include <vector>
+#include <string>
+#include "TrjReader.h"
+
+/** TrjIndex lists the TIMESTEP records of a TRJ file: the time, the byte offset
+  * and the number of vehicle records of each time step. Vehicle records have
+  * a fixed size, so the index is built by skipping over them without decoding.
+  * The index can be kept in a sidecar file next to the TRJ file, which is
+  * valid as long as the size and modification time of the TRJ file are unchanged.
+*/
+class TrjIndex
+{
+public:
+	/** Entry describes one TIMESTEP record
+	*/
+	struct Entry
+	{
+		float m_TimeStep; /*!< Seconds since the start of the simulation */
+		long long m_Offset; /*!< Offset of the TIMESTEP record from the beginning of the file */
+		int m_NVehicles; /*!< Number of vehicle records following the TIMESTEP record */
+	};
+
+	TrjIndex() {}
+	~TrjIndex() {}
+
+	/** Scan the time step records from the current position of a reader to the end of file.
+	 * The reader is left at the end of file.
+	 * @param reader the TRJ reader positioned after the header records
+	 * @param version TRJ file format version
+	 */
+	void Build(TrjReader& reader, float version);
+
+	/** Add a time step record at the end of the index.
+	 * @param t time of the time step
+	 * @param offset offset of the TIMESTEP record from the beginning of the file
+	 * @param nVehicles number of vehicle records following the TIMESTEP record
+	 */
+	void AddEntry(float t, long long offset, int nVehicles)
+	{
+		Entry e;
+		e.m_TimeStep = t;
+		e.m_Offset = offset;
+		e.m_NVehicles = nVehicles;
+		m_Entries.push_back(e);
+	}
+
+	/** Find the first time step at or after a time.
+	 * @param t time in seconds
+	 * @return index of the entry, or the number of entries if all time steps are before t
+	 */
+	size_t FindTimeStep(float t) const;
+
+	/** Find the first time step after a time.
+	 * @param t time in seconds
+	 * @return index of the entry, or the number of entries if no time step is after t
+	 */
+	size_t FindTimeStepAfter(float t) const;
+
+	/** Save the index to a sidecar file.
+	 * @param indexFileName name of the index file
+	 * @param sourceSize size of the indexed TRJ file in bytes
+	 * @param sourceTime last modification time of the indexed TRJ file
+	 * @return false if the index file could not be written
+	 */
+	bool Save(const std::string& indexFileName, long long sourceSize, long long sourceTime) const;
+
+	/** Load the index from a sidecar file.
+	 * @param indexFileName name of the index file
+	 * @param sourceSize size of the indexed TRJ file in bytes
+	 * @param sourceTime last modification time of the indexed TRJ file
+	 * @return false if the index file does not exist, is damaged, or was built from another version of the TRJ file
+	 */
+	bool Load(const std::string& indexFileName, long long sourceSize, long long sourceTime);
+
+	/** Get the name of the sidecar index file of a TRJ file.
+	 * @param trjFileName name of the TRJ file
+	 * @return name of the index file
+	 */
+	static std::string GetIndexFileName(const std::string& trjFileName) { return trjFileName + ".idx"; }
+
+	/** Get the size of a vehicle record, excluding the record type byte.
+	 * @param version TRJ file format version
+	 * @return number of bytes
+	 */
+	static int GetVehicleRecordSize(float version);
+
+	void Clear() { m_Entries.clear(); }
+	bool IsEmpty() const { return m_Entries.empty(); }
+	size_t GetSize() const { return m_Entries.size(); }
+	const Entry& GetEntry(size_t i) const { return m_Entries[i]; }
+	const std::vector<Entry>& GetEntries() const { return m_Entries; }
+private:
+	const static char MAGIC[8]; /*!< Leading bytes of an index file, ending with the index file version */
+	std::vector<Entry> m_Entries; /*!< Time step records in the order of the file */
+};
+
+#endif
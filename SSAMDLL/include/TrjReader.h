@@ -0,0 +1,227 @@
+/*------------------------------------------------------------------------------
+   Copyright  2016-2017
+   New Global Systems for Intelligent Transportation Management Corp.
+
+   This file is part of SSAM.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Affero General Public License as
+   published by the Free Software Foundation, either version 3 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------------*/
+#pragma once
+#ifndef TRJREADER_H
+#define TRJREADER_H
+#include <string>
+#include <cstring>
+#include "INCLUDE.h"
+
+/** MappedFile maps a read-only file into memory. Files larger than
+  * the view size are mapped through a sliding view, so that any size of file
+  * can be read in both 32-bit and 64-bit processes.
+*/
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	/** Open and map a file.
+	 * @param fileName name of the file to map
+	 */
+	void Open(const std::string& fileName);
+
+	/** Unmap and close the current file.
+	 */
+	void Close();
+
+	/** Get a pointer to the mapped bytes [offset, offset + length).
+	 * The pointer stays valid until the next call of GetView() or Close().
+	 * @param offset offset of the first byte from the beginning of the file
+	 * @param length number of bytes to access
+	 * @return pointer to the first byte
+	 */
+	const char* GetView(long long offset, size_t length)
+	{
+		if (offset < m_ViewOffset || offset + (long long)length > m_ViewOffset + (long long)m_ViewSize)
+			MapView(offset, length);
+		return m_pView + (offset - m_ViewOffset);
+	}
+
+	bool IsOpen() const { return m_IsOpen; }
+	long long GetSize() const { return m_Size; }
+	long long GetModifiedTime() const { return m_ModifiedTime; }
+	const std::string& GetFileName() const { return m_FileName; }
+private:
+	std::string m_FileName; /*!< Name of the mapped file */
+	bool m_IsOpen; /*!< Flag to indicate whether a file is open */
+	long long m_Size; /*!< Size of the file in bytes */
+	long long m_ModifiedTime; /*!< Last modification time of the file */
+	const char* m_pView; /*!< Pointer to the first byte of the current view */
+	long long m_ViewOffset; /*!< Offset of the current view from the beginning of the file */
+	size_t m_ViewSize; /*!< Number of bytes in the current view */
+	void* m_hFile; /*!< Handle of the file */
+	void* m_hMapping; /*!< Handle of the file mapping */
+
+	/** Map a new view that covers the bytes [offset, offset + length).
+	 * @param offset offset of the first byte from the beginning of the file
+	 * @param length number of bytes to access
+	 */
+	void MapView(long long offset, size_t length);
+
+	/** Unmap the current view.
+	 */
+	void UnmapView();
+
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+};
+
+/** TrjReader decodes the binary values of a TRJ file directly
+  * from the memory-mapped file buffer.
+*/
+class TrjReader
+{
+public:
+	const static int INT_SIZE = sizeof(int);
+	const static int FLOAT_SIZE = sizeof(float);
+
+	TrjReader()
+		: m_Pos(0)
+		, m_IsSwap(false)
+		, m_IsEof(false)
+	{}
+	~TrjReader() {}
+
+	/** Open a TRJ file for reading.
+	 * @param fileName name of the TRJ file
+	 */
+	void Open(const std::string& fileName)
+	{
+		m_File.Open(fileName);
+		m_Pos = 0;
+		m_IsSwap = false;
+		m_IsEof = false;
+	}
+
+	/** Close the TRJ file.
+	 */
+	void Close() { m_File.Close(); }
+
+	/** Set the byte endianness of the values to decode.
+	 * @param endian 'L' - little endian; 'B' - big endian
+	 */
+	void SetEndian(char endian) { m_IsSwap = (endian == 'B'); }
+
+	/** Move the read position.
+	 * @param pos offset from the beginning of the file
+	 */
+	void Seek(long long pos)
+	{
+		m_Pos = pos;
+		m_IsEof = false;
+	}
+
+	bool IsOpen() const { return m_File.IsOpen(); }
+	bool IsEnd() const { return m_Pos >= m_File.GetSize(); }
+	bool IsEof() const { return m_IsEof; }
+	long long GetSize() const { return m_File.GetSize(); }
+	long long GetModifiedTime() const { return m_File.GetModifiedTime(); }
+	long long GetPosition() const { return m_Pos; }
+
+	/** Claim the next bytes of the file for decoding and advance the read position.
+	 * @param n number of bytes
+	 * @return pointer to the first claimed byte
+	 */
+	const char* Require(size_t n)
+	{
+		if (m_Pos + (long long)n > m_File.GetSize())
+		{
+			m_IsEof = true;
+			throw SSAMException("file reading failed");
+		}
+		const char* p = m_File.GetView(m_Pos, n);
+		m_Pos += n;
+		return p;
+	}
+
+	/** Read a byte.
+	 * @return byte value
+	 */
+	char ReadByte() { return *Require(1); }
+
+	/** Read an integer number.
+	 * @return int value
+	 */
+	int ReadInt() { return GetInt(Require(INT_SIZE)); }
+
+	/** Read a float number.
+	 * @return float value
+	 */
+	float ReadFloat() { return GetFloat(Require(FLOAT_SIZE)); }
+
+	/** Decode an integer number from a claimed buffer.
+	 * @param p pointer to the first byte of the value
+	 * @return int value
+	 */
+	int GetInt(const char* p) const
+	{
+		int x = 0;
+		if (m_IsSwap)
+		{
+			char buffer[INT_SIZE];
+			SwapBytes(p, buffer, INT_SIZE);
+			memcpy(&x, buffer, INT_SIZE);
+		} else
+		{
+			memcpy(&x, p, INT_SIZE);
+		}
+		return x;
+	}
+
+	/** Decode a float number from a claimed buffer.
+	 * @param p pointer to the first byte of the value
+	 * @return float value
+	 */
+	float GetFloat(const char* p) const
+	{
+		float x = 0;
+		if (m_IsSwap)
+		{
+			char buffer[FLOAT_SIZE];
+			SwapBytes(p, buffer, FLOAT_SIZE);
+			memcpy(&x, buffer, FLOAT_SIZE);
+		} else
+		{
+			memcpy(&x, p, FLOAT_SIZE);
+		}
+		return x;
+	}
+
+private:
+	MappedFile m_File; /*!< The mapped TRJ file */
+	long long m_Pos; /*!< Current read position */
+	bool m_IsSwap; /*!< Flag to indicate whether to convert big endian values */
+	bool m_IsEof; /*!< Flag to indicate whether a read past the end of file was attempted */
+
+	/** Copy bytes in reversed order.
+	 * @param src source bytes
+	 * @param dst destination buffer
+	 * @param size number of bytes
+	 */
+	static void SwapBytes(const char* src, char* dst, int size)
+	{
+		for (int i = 0; i < size; ++i)
+			dst[i] = src[size - 1 - i];
+	}
+};
+
+#endif
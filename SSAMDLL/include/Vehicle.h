@@ -31,9 +31,31 @@
 
 // Forward declaration of Vehicle class
 class Vehicle;
+class VehicleShapes;
+class VehicleTracks;
 /** Smart pointer type to Vehicle class.
 */
 typedef std::shared_ptr<Vehicle> SP_Vehicle;
+/** Vehicles of one time step, in which a vehicle of the previous time step finds its next data by index.
+*/
+typedef std::vector<SP_Vehicle> StepVehicles;
+/** Vehicles of consecutive time steps of the analysis window, by which a trajectory is walked.
+*/
+typedef std::vector<const StepVehicles*> StepWindow;
+
+/** PathPiece is a part of the projected path of a vehicle during which the footprint moves without turning.
+  * The footprint at a time t in [m_StartTime, m_EndTime] has the corners at m_StartTime moved by (t - m_StartTime) times the velocity.
+*/
+struct PathPiece
+{
+	float m_StartTime; /*!< Time since the time step at the start of the piece */
+	float m_EndTime; /*!< Time since the time step at the end of the piece */
+	float m_CornerX[4]; /*!< X coordinates of the corners at the start of the piece */
+	float m_CornerY[4]; /*!< Y coordinates of the corners at the start of the piece */
+	float m_VelocityX; /*!< Velocity in X, in X, Y Units per second */
+	float m_VelocityY; /*!< Velocity in Y, in X, Y Units per second */
+	float m_CenterZ; /*!< Z coordinate of the center of the footprint */
+};
 
 
 /** Vehicle manages data of a vehicle in one time step
@@ -73,7 +95,9 @@ public:
 		, m_MinY (0)
 		, m_MaxX (0)
 		, m_MaxY (0)
-		, m_pNext (NULL)
+		, m_NextIndex (-1)
+		, m_Track (-1)
+		, m_TrackPos (-1)
 	{
 		for (int i = 0; i < 4; ++i)
 		{
@@ -111,15 +135,46 @@ public:
 	SSAMFUNCSDLL_API void SetPosition(float frontX, float frontY, float rearX, float rearY);
 
 	/** Calculate vehicle projection position in maxTTC.
+	* The position on the trajectory is found by binary search of the distance travelled along the vehicle's track.
 	* @param maxTTC maxTTC threshold
 	* @param maxPET maxPET threshold
+	* @param tracks tracks of the vehicles in the analysis window
+	* @param shapes footprints to store the projection in
+	* @param i index of the projection in shapes
 	*/
-	SP_Vehicle CalcProjection(float maxTTC, float maxPET);
+	void CalcProjection(float maxTTC, float maxPET, const VehicleTracks& tracks, VehicleShapes& shapes, size_t i) const;
+
+	/** Calculate the projected path of the vehicle from now to maxTTC, which passes through the projections
+	* calculated by CalcProjection at each TTC in [0, maxTTC].
+	* @param maxTTC maxTTC threshold
+	* @param maxPET maxPET threshold
+	* @param tracks tracks of the vehicles in the analysis window
+	* @param path output pieces of the path, in the order of time
+	*/
+	void CalcPath(float maxTTC, float maxPET, const VehicleTracks& tracks, std::vector<PathPiece>& path) const;
+
+	/** Calculate the corners and the bounding box of a vehicle footprint.
+	* @param frontX X coordinate of the middle front bumper of the vehicle
+	* @param frontY Y coordinate of the middle front bumper of the vehicle
+	* @param rearX X coordinate of the middle rear bumper of the vehicle
+	* @param rearY Y coordinate of the middle rear bumper of the vehicle
+	* @param scaledWidth vehicle width in X, Y Units
+	* @param cornerX output X coordinates of the four corners
+	* @param cornerY output Y coordinates of the four corners
+	* @param minX output left edge of the footprint
+	* @param minY output bottom edge of the footprint
+	* @param maxX output right edge of the footprint
+	* @param maxY output top edge of the footprint
+	*/
+	static void CalcFootprint(float frontX, float frontY, float rearX, float rearY, float scaledWidth,
+		float* cornerX, float* cornerY, float& minX, float& minY, float& maxX, float& maxY);
 	
-	/** Check whether the input vehicle intersects with this vehicle.
-	* @param v A vehicle for collision check
+	/** Find the vehicles of an array that intersect with this vehicle, testing their edges in batches.
+	* @param others the vehicles to check
+	* @param n number of vehicles
+	* @param crashes output positions in others of the vehicles intersecting with this vehicle, in increasing order
 	*/
-	bool IsCollided(SP_Vehicle v);
+	void FindCollisions(const Vehicle* others, size_t n, std::vector<int>& crashes) const;
 
 	/** Print current vehicle info.
 	* @param output the output stream
@@ -141,7 +196,12 @@ public:
 	void setScale(float f) { m_Scale = f; }
 	void SetSpeed(float f) { m_Speed = f; }
 	void SetAcceleration(float f) { m_Acceleration = f; }
-	void SetNext(SP_Vehicle v) { m_pNext = v; }
+	void SetNextIndex(int i) { m_NextIndex = i; }
+	void SetTrack(int track, int pos) { m_Track = track; m_TrackPos = pos; }
+
+	/** Clear the links of the vehicle to the vehicle data of other time steps
+	*/
+	void Unlink() { m_NextIndex = -1; m_Track = -1; m_TrackPos = -1; }
 	void SetLength(float f)
 	{
 		m_Length = f; 
@@ -173,16 +233,29 @@ public:
 	float GetWidth() const { return m_Width; }
 	float GetSpeed() const { return m_Speed; }
 	float GetAcceleration() const { return m_Acceleration; }
-	SP_Vehicle GetNext() const { return m_pNext; }
-	float GetCenterX(){return m_RearX + (m_FrontX-m_RearX)/2.0; }
-	float GetCenterY(){return m_RearY + (m_FrontY-m_RearY)/2.0; }
-	float GetCenterZ(){return m_RearZ + (m_FrontZ-m_RearZ)/2.0; }
+	int GetNextIndex() const { return m_NextIndex; }
+	int GetTrack() const { return m_Track; }
+	int GetTrackPos() const { return m_TrackPos; }
+	float GetCenterX() const {return m_RearX + (m_FrontX-m_RearX)/2.0; }
+	float GetCenterY() const {return m_RearY + (m_FrontY-m_RearY)/2.0; }
+	float GetCenterZ() const {return m_RearZ + (m_FrontZ-m_RearZ)/2.0; }
 	const float* GetCornerXs() const { return m_CornerX; }
 	const float* GetCornerYs() const { return m_CornerY; }
 	float GetMaxX() const {return m_MaxX;}
 	float GetMaxY() const {return m_MaxY;}
 	float GetMinX() const {return m_MinX;}
 	float GetMinY() const {return m_MinY;}
+	float GetScaledWidth() const {return m_ScaledWidth;}
+
+	/** Get the distance between the input vehicle and this vehicle
+	* @param v A vehicle for calculating the distance
+	*/
+	float GetV2VDistance(const Vehicle& v) const
+	{
+		float x = GetCenterX() - v.GetCenterX();
+		float y = GetCenterY() - v.GetCenterY();
+		return sqrt(x*x + y*y);
+	}
 private:
 	float m_TimeStep; /*!< Seconds since the start of the simulation */
 	int m_VehicleID; /*!< Unique identifier number of the vehicle */
@@ -207,7 +280,9 @@ private:
 	float m_MinY; /*!< Bottom edge of the vehicle occupying area.*/
 	float m_MaxX; /*!< Right edge of the vehicle occupying area.*/
 	float m_MaxY; /*!< Top edge of the vehicle occupying area.*/
-	SP_Vehicle m_pNext; /*!< Pointer to vehicle data of next time step */ 
+	int m_NextIndex; /*!< Index of the vehicle data in the vehicles of next time step, -1 if the vehicle is not in next time step */ 
+	int m_Track; /*!< ID of the track of the vehicle in the analysis window, -1 if the vehicle is not tracked */
+	int m_TrackPos; /*!< Position of the vehicle data in its track */
 
 	/** Copy values from another Vehicle object
 	* @param rhs Const reference to a Vehicle object from which the values are copied
@@ -242,19 +317,12 @@ private:
 			m_CornerY[i] = rhs.m_CornerY[i];
 		}
 
-		m_pNext = rhs.m_pNext;
-	}
-	
-	/** Get the distance between the input vehicle and this vehicle
-	* @param v A vehicle for calculating the distance
-	*/
-	float GetV2VDistance(Vehicle& v)
-	{
-		float x = GetCenterX() - v.GetCenterX();
-		float y = GetCenterY() - v.GetCenterY();
-		return sqrt(x*x + y*y);
+		m_NextIndex = rhs.m_NextIndex;
+		m_Track = rhs.m_Track;
+		m_TrackPos = rhs.m_TrackPos;
 	}
 
+
 	/** Calculate the offset for a point perpendicular to the line between
 	* point 1 and and point 2 with a specified distance from the line,
 	* returned point is on the right side of direction P2->P1
@@ -266,9 +334,87 @@ private:
 	* @param dx output x offset
 	* @param dy output y offset
 	*/
-	void CalcPerpOffset(float x1, float y1, float x2, float y2, float dist,
+	static void CalcPerpOffset(float x1, float y1, float x2, float y2, float dist,
 		float &dx, float &dy);
 };
 
+/** VehicleShapes stores the footprints of a set of vehicles in contiguous arrays,
+  * so that the footprints are tested for collision without visiting the vehicle objects.
+*/
+class VehicleShapes
+{
+public:
+	VehicleShapes() {}
+
+	/** Create room for a number of footprints.
+	* @param n number of footprints
+	*/
+	explicit VehicleShapes(size_t n) { Resize(n); }
+
+	/** Change the number of footprints. The memory is kept when the number shrinks.
+	* @param n number of footprints
+	*/
+	void Resize(size_t n)
+	{
+		m_CornerX.resize(4 * n);
+		m_CornerY.resize(4 * n);
+		m_MinX.resize(n);
+		m_MinY.resize(n);
+		m_MaxX.resize(n);
+		m_MaxY.resize(n);
+		m_CenterX.resize(n);
+		m_CenterY.resize(n);
+		m_CenterZ.resize(n);
+	}
+
+	/** Copy the footprint of a vehicle.
+	* @param i index of the footprint
+	* @param v the vehicle
+	*/
+	void Set(size_t i, const Vehicle& v);
+
+	/** Set the footprint of a vehicle moved to a new position.
+	* @param i index of the footprint
+	* @param v the vehicle
+	* @param frontX X coordinate of the middle front bumper at the new position
+	* @param frontY Y coordinate of the middle front bumper at the new position
+	* @param rearX X coordinate of the middle rear bumper at the new position
+	* @param rearY Y coordinate of the middle rear bumper at the new position
+	*/
+	void SetPosition(size_t i, const Vehicle& v, float frontX, float frontY, float rearX, float rearY);
+
+	/** Check whether two footprints intersect.
+	* @param i index of the first footprint
+	* @param j index of the second footprint
+	*/
+	bool IsCollided(size_t i, size_t j) const;
+
+	/** Find the footprints of a list that intersect with a footprint, testing their edges in batches.
+	* @param i index of the footprint
+	* @param candidates indexes of the footprints to check
+	* @param n number of candidates
+	* @param crashes the indexes of the candidates intersecting with the footprint are appended, in the order of candidates
+	*/
+	void FindCollisions(size_t i, const int* candidates, size_t n, std::vector<int>& crashes) const;
+
+	size_t GetSize() const { return m_MinX.size(); }
+	float GetCenterX(size_t i) const { return m_CenterX[i]; }
+	float GetCenterY(size_t i) const { return m_CenterY[i]; }
+	float GetMinX(size_t i) const { return m_MinX[i]; }
+	float GetMinY(size_t i) const { return m_MinY[i]; }
+	float GetMaxX(size_t i) const { return m_MaxX[i]; }
+	float GetMaxY(size_t i) const { return m_MaxY[i]; }
+private:
+	std::vector<float> m_CornerX; /*!< X coordinates of the corners, four per footprint */
+	std::vector<float> m_CornerY; /*!< Y coordinates of the corners, four per footprint */
+	std::vector<float> m_MinX; /*!< Left edges of the footprints */
+	std::vector<float> m_MinY; /*!< Bottom edges of the footprints */
+	std::vector<float> m_MaxX; /*!< Right edges of the footprints */
+	std::vector<float> m_MaxY; /*!< Top edges of the footprints */
+	std::vector<float> m_CenterX; /*!< X coordinates of the vehicle centers */
+	std::vector<float> m_CenterY; /*!< Y coordinates of the vehicle centers */
+	std::vector<float> m_CenterZ; /*!< Z coordinates of the vehicle centers */
+};
+
 
 #endif
@@ -0,0 +1,115 @@
+/*------------------------------------------------------------------------------
+   Copyright  2016-2017
+   New Global Systems for Intelligent Transportation Management Corp.
+
+   This file is part of SSAM.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Affero General Public License as
+   published by the Free Software Foundation, either version 3 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------------*/
+#pragma once
+#ifndef VEHICLEARENA_H
+#define VEHICLEARENA_H
+#include <memory>
+#include <vector>
+#include <deque>
+#include "Vehicle.h"
+
+/** VehicleArena keeps the vehicles of one time step in a few contiguous blocks.
+  * The vehicles are handed out as smart pointers sharing the ownership of the arena,
+  * so the vehicles of a time step are released together when the last of them is released.
+*/
+class VehicleArena
+{
+public:
+	VehicleArena();
+
+	/** Allocate a default vehicle at the end of the arena.
+	 * @return reference to the vehicle, valid until the arena is reset
+	 */
+	Vehicle& Allocate();
+
+	/** Return the last allocated vehicle to the arena.
+	 */
+	void FreeLast();
+
+	/** Destroy all vehicles, keeping the blocks to reuse for another time step.
+	 */
+	void Reset();
+
+	size_t GetSize() const { return m_NVehicles; }
+	long long GetNAllocated() const { return m_NAllocated; }
+	long long GetNBlocks() const { return m_NBlocks; }
+private:
+	const static size_t MIN_BLOCK_SIZE = 256; /*!< Number of vehicles of the first block */
+	std::deque<std::vector<Vehicle> > m_Blocks; /*!< Blocks of vehicles, each filled up to its capacity and never reallocated */
+	size_t m_Block; /*!< Index of the block being filled */
+	size_t m_NVehicles; /*!< Number of vehicles in the arena */
+	long long m_NAllocated; /*!< Number of vehicles allocated since the arena is created */
+	long long m_NBlocks; /*!< Number of blocks allocated from the heap since the arena is created */
+
+	VehicleArena(const VehicleArena&);
+	VehicleArena& operator=(const VehicleArena&);
+};
+/** Smart pointer type to VehicleArena class.
+*/
+typedef std::shared_ptr<VehicleArena> SP_VehicleArena;
+
+/** VehiclePool recycles the arenas of the time steps in the analysis window.
+  * An arena is reused once no vehicle of it is referenced any more, which is the case
+  * for the oldest time steps after they leave the window, unless an open event keeps them.
+*/
+class VehiclePool
+{
+public:
+	VehiclePool();
+
+	/** Get an empty arena for a new time step, reusing a released arena if there is one.
+	 * Only one thread may acquire arenas from a pool, the vehicles may be released by any thread.
+	 * @return smart pointer to the arena
+	 */
+	SP_VehicleArena Acquire();
+
+	/** Drop the arenas kept for reuse. The counters are kept.
+	 */
+	void Clear();
+
+	/** Add the counters of another pool, e.g. the pool of a worker.
+	 * @param other the other pool
+	 */
+	void AddCounts(const VehiclePool& other);
+
+	/** Get the number of vehicles allocated in the arenas of the pool.
+	 * @return number of vehicles
+	 */
+	long long GetNVehicles() const;
+
+	/** Get the number of vehicle blocks allocated from the heap by the arenas of the pool.
+	 * @return number of blocks
+	 */
+	long long GetNBlocks() const;
+
+	long long GetNArenas() const { return m_NArenas; }
+	long long GetNReuses() const { return m_NReuses; }
+private:
+	std::vector<SP_VehicleArena> m_Arenas; /*!< Arenas of the pool, in the order they were last acquired */
+	size_t m_Next; /*!< Index of the arena to check first on the next acquisition */
+	long long m_NVehicles; /*!< Number of vehicles allocated by dropped arenas and added pools */
+	long long m_NBlocks; /*!< Number of blocks allocated by dropped arenas and added pools */
+	long long m_NArenas; /*!< Number of arenas created */
+	long long m_NReuses; /*!< Number of arenas reused */
+
+	VehiclePool(const VehiclePool&);
+	VehiclePool& operator=(const VehiclePool&);
+};
+#endif // VEHICLEARENA_H
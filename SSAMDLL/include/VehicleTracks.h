@@ -0,0 +1,99 @@
+/*------------------------------------------------------------------------------
+   Copyright  2016-2017
+   New Global Systems for Intelligent Transportation Management Corp.
+
+   This file is part of SSAM.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Affero General Public License as
+   published by the Free Software Foundation, either version 3 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------------*/
+#pragma once
+#ifndef VEHICLETRACKS_H
+#define VEHICLETRACKS_H
+#include <vector>
+#include "Vehicle.h"
+
+/** TrackPoint is the data of a vehicle at one time step of its track
+*/
+struct TrackPoint
+{
+	const Vehicle* m_pVehicle; /*!< Pointer to the vehicle data of the time step */
+	double m_Arc; /*!< Distance in X, Y Units travelled from the start of the track */
+	float m_StepDist; /*!< Distance in X, Y Units from the vehicle data of the previous time step */
+	int m_NStops; /*!< Number of time steps without movement from the start of the track */
+};
+
+/** VehicleTracks keeps the track of each vehicle in the analysis window as the cumulative distance
+  * travelled at each of its time steps, so that the position a distance ahead is found by binary search.
+  * A track is extended as time steps are added, and shortened as time steps leave the window.
+  * A vehicle refers to its point by the track ID and the position of the point in the track.
+*/
+class VehicleTracks
+{
+public:
+	VehicleTracks() {}
+
+	/** Extend the tracks of the vehicles of the previous time step found in a new time step, and start a track
+	 * for each other vehicle. The vehicles of the previous time step must be linked to the new time step.
+	 * @param pPrevStep vehicles of the previous time step, NULL if the new time step is the first of the window
+	 * @param step vehicles of the new time step
+	 */
+	void AddTimeStep(const StepVehicles* pPrevStep, const StepVehicles& step);
+
+	/** Remove the first point of the track of each vehicle of the time step leaving the window.
+	 * @param step vehicles of the first time step of the window
+	 */
+	void RemoveTimeStep(const StepVehicles& step);
+
+	/** Remove all tracks.
+	 */
+	void Clear();
+
+	/** Get the points of a track from a position to the last time step of the window.
+	 * @param track ID of the track
+	 * @param pos position of the first point in the track
+	 * @param nPoints output number of points
+	 * @return pointer to the first point, valid until the tracks are changed
+	 */
+	const TrackPoint* GetPoints(int track, int pos, size_t& nPoints) const
+	{
+		const Track& t = m_Tracks[track];
+		size_t first = t.m_First + (pos - t.m_FirstPos);
+		nPoints = t.m_Points.size() - first;
+		return &t.m_Points[first];
+	}
+
+	size_t GetNTracks() const { return m_Tracks.size() - m_FreeTracks.size(); }
+
+	/** Get the number of track IDs in use or free, each track ID is less than this number.
+	 * @return number of track IDs
+	 */
+	size_t GetNTrackIDs() const { return m_Tracks.size(); }
+private:
+	/** Track keeps the points of a vehicle from the first time step of the window
+	*/
+	struct Track
+	{
+		std::vector<TrackPoint> m_Points; /*!< Points of the track, those before m_First have left the window */
+		size_t m_First; /*!< Index of the first point in the window */
+		int m_FirstPos; /*!< Position in the track of the first point in the window */
+	};
+	std::vector<Track> m_Tracks; /*!< Tracks by ID */
+	std::vector<int> m_FreeTracks; /*!< IDs of the tracks to reuse */
+
+	/** Start a track with a vehicle.
+	 * @param v the vehicle
+	 */
+	void StartTrack(Vehicle& v);
+};
+#endif // VEHICLETRACKS_H
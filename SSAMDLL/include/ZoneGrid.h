@@ -29,6 +29,14 @@
 
 /** ZoneGrid is constructed to conver the entire rectangular analysis area
   * using the width and height from TRJ file.
+  * The grid is rebuilt for each time step by a counting sort of the vehicles into the zones they overlap:
+  * the occupied zones are numbered in the order they are first occupied, and the vehicles of each
+  * occupied zone are stored together in one array, delimited by an offset per occupied zone.
+  * The zones of the vehicles are found and stored, and the crashes are found, by all threads,
+  * each thread with its own buffers; only the numbering of the zones is done by one thread.
+  * The number of an occupied zone is found in an array over all zones, or, if the grid has more than
+  * MAX_DENSE_ZONES zones, in a hash table of the occupied zones, so that the memory of a large area
+  * grows with the number of vehicles rather than with the area.
 */
 class ZoneGrid
 {
@@ -47,6 +55,9 @@ public:
 
 	~ZoneGrid(){}
 
+	static const long long MAX_DENSE_ZONES = 5575680; /*!< Maximum number of zones numbered by an array over all zones, about 500 square miles of zones of 50 feet */
+	static const int TUNE_INTERVAL = 100; /*!< Number of time steps between tunings of the zone size */
+
 	/** Reset the ZoneGrid with parameters
 	 * @param xMin Left edge of grid
 	 * @param yMin Bottom edge of grid
@@ -57,56 +68,62 @@ public:
 	void ResetGrid(int xMin, int yMin, int xMax, int yMax, int size);
 
 	/**
-	 * Remove occupants in used zones.
+	 * Remove the vehicles from the occupied zones.
 	 */
-	void ClearGrid()
-	{
-		for (std::vector<UsedZone>::iterator it = m_UsedZones.begin();
-			it != m_UsedZones.end(); ++it)
-		{
-			m_Zones[it->first][it->second]->Clear();
-		}
-		m_UsedZones.clear();
-	}
+	void ClearGrid();
+
+	/**
+	 * Fill the grid with the vehicles of a time step, in parallel. A vehicle with the center
+	 * outside the analysis area is not added.
+	 * @param shapes footprints of the vehicles
+	 * @param vehicles indexes of the footprints of the vehicles to add, in increasing order
+	 */
+	void Build(const VehicleShapes& shapes, const std::vector<int>& vehicles);
 
 	/**
-	 * Add the new vehicle to the zone grid and check whether there is
-	 * any other vehicle it crashes with.  
-	 * @param vNew New vehicle to add
-	 * @param allCrashes A set of all other vehicles the new vehicle crashes with
+	 * Find the pairs of vehicles of the grid that crash with each other, the zones in parallel.
+	 * @param shapes footprints of the vehicles added to the grid
+	 * @param crashes output pairs of footprint indexes, the lower index first, each pair once, in increasing order
 	 */
-	void AddVehicle(SP_Vehicle vNew, std::map<int, SP_Vehicle>& allCrashes);
+	void FindCrashes(const VehicleShapes& shapes, std::vector<std::pair<int, int> >& crashes);
+
+	/**
+	 * Choose the zone size for the vehicles of a time step, and reset the grid with it.
+	 * The grid is built with sizes from a quarter to four times the base size, and the size with the
+	 * least work is chosen: the zone entries of the vehicles plus the pairs of vehicles sharing a zone.
+	 * The current size is kept unless the chosen size saves a tenth of its work.
+	 * The crashes found do not depend on the zone size.
+	 * @param shapes footprints of the vehicles
+	 * @param vehicles indexes of the footprints of the vehicles, in increasing order
+	 * @param baseSize zone size for the units of the analysis area
+	 * @return the chosen zone size
+	 */
+	int TuneZoneSize(const VehicleShapes& shapes, const std::vector<int>& vehicles, int baseSize);
+
+	int GetNOccupiedZones() const { return (int)m_OccupiedZones.size(); }
+	long long GetNZones() const { return m_NZones; }
+	int GetZoneSize() const { return m_ZoneSize; }
+	bool IsSparse() const { return m_NZones > MAX_DENSE_ZONES; }
 	
 private:
-	/** Zone maintains a list of occupying vehicles.
+	/** ZoneRange is the range of zones overlapped by the footprint of a vehicle
 	*/
-	class Zone
+	struct ZoneRange
 	{
-	public:
-		/**
-		 * Add a new occupying vehicle to the zone and checks whether it crashes 
-		 * with other vehicles in the zone.
-		 * @param vNew A pointer to a new vehicle.
-		 * @param allCrashes A list of vehicles crashing with new vehicle.
-		 */
-		void AddVehicle(SP_Vehicle vNew, std::map<int, SP_Vehicle>& allCrashes);
-
-		/** Remove all vehicles from this zone.
-		*/
-		void Clear()
-		{
-			m_Occupants.clear();	
-		}
-	private:	
-		/** The list of vehicles occupying this zone
-		*/
-	    std::list<SP_Vehicle> m_Occupants;
+		int m_MinX; /*!< First zone along x-axis */
+		int m_MinY; /*!< First zone along y-axis */
+		int m_MaxX; /*!< Last zone along x-axis */
+		int m_MaxY; /*!< Last zone along y-axis */
 	};
 
-	/** Smart pointer type to Zone class.
+	/** CrashBuffer keeps the vehicles checked and found by one thread finding crashes
 	*/
-	typedef std::shared_ptr<Zone> SP_Zone;
-	typedef std::pair<int, int> UsedZone;
+	struct CrashBuffer
+	{
+		std::vector<int> m_Candidates; /*!< Vehicles of a zone to check for crashes with a vehicle */
+		std::vector<int> m_Found; /*!< Vehicles found crashing with a vehicle */
+		std::vector<std::pair<int, int> > m_Crashes; /*!< Pairs of vehicles found crashing by the thread */
+	};
 
 	int m_OrigMinX; /*!< Left edge of original grid */
 	int m_OrigMinY; /*!< Bottom edge of original grid */
@@ -119,11 +136,41 @@ private:
 	int m_ZoneSize; /*!< Dimension of a single zone */
 	int m_NXZones;  /*!< Number of zones along x-axis */
 	int m_NYZones;	/*!< Number of zones along y-axis */
-	int m_NZones;   /*!< Total number of zones */
-	int m_NZonesUsed ; /*!< Total number of used zones */
-	std::vector<std::vector<SP_Zone> > m_Zones; /*!< A matrix of zones */
-	std::vector<UsedZone> m_UsedZones; /*!< A vector stores all used zones. */
-	
+	long long m_NZones;   /*!< Total number of zones */
+	std::vector<int> m_ZoneSlots; /*!< Number of each zone among the occupied zones, -1 if not occupied, if the grid is not sparse */
+	std::vector<long long> m_HashZones; /*!< Hash table of the occupied zones, -1 for an empty entry, if the grid is sparse */
+	std::vector<int> m_HashSlots; /*!< Number among the occupied zones of the zones of the hash table */
+	std::vector<long long> m_OccupiedZones; /*!< Zones occupied by vehicles, x index * m_NYZones + y index */
+	std::vector<int> m_ZoneOffsets; /*!< Start of the vehicles of each occupied zone in m_ZoneVehicles, and the end of the last */
+	std::vector<int> m_ZoneVehicles; /*!< Footprint indexes of the vehicles of the occupied zones, increasing in each zone */
+	std::vector<ZoneRange> m_Ranges; /*!< Zones overlapped by the vehicles, by footprint index */
+	std::vector<int> m_Fill; /*!< Number of vehicles of each occupied zone while building */
+	std::vector<int> m_EntryStarts; /*!< Start of the zone entries of each vehicle added, and the end of the last */
+	std::vector<long long> m_EntryZones; /*!< Zone of each zone entry, replaced by its number among the occupied zones */
+	std::vector<int> m_EntryRanks; /*!< Position of each zone entry among the vehicles of its zone */
+	std::vector<CrashBuffer> m_CrashBuffers; /*!< Buffers of the threads finding crashes */
+
+	/**
+	 * Find the zones overlapped by the footprint of a vehicle.
+	 * @param shapes footprints of the vehicles
+	 * @param i index of the footprint
+	 * @param range output range of zones
+	 * @return false if the center of the vehicle is outside the analysis area
+	 */
+	bool FindZones(const VehicleShapes& shapes, int i, ZoneRange& range) const;
+
+	/**
+	 * Find the number of a zone among the occupied zones, adding the zone to the hash table if the grid is sparse.
+	 * @param zone the zone, x index * m_NYZones + y index
+	 * @return reference to the number of the zone, -1 if the zone is not occupied yet
+	 */
+	int& FindSlot(long long zone);
+
+	/**
+	 * Count the work of finding the crashes of the grid.
+	 * @return number of zone entries plus number of pairs of vehicles sharing a zone
+	 */
+	long long CountWork() const;
 };
 
 /** Smart pointer type to ZoneGrid class.
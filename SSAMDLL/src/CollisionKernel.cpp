@@ -0,0 +1,100 @@
+/*------------------------------------------------------------------------------
+   Copyright  2016-2017
+   New Global Systems for Intelligent Transportation Management Corp.
+
+   This file is part of SSAM.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Affero General Public License as
+   published by the Free Software Foundation, either version 3 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------------*/
+#include "stdafx.h"
+#include "CollisionKernel.h"
+#include "Utility.h"
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1) || defined(__SSE__)
+#define SSAM_SSE
+#include <xmmintrin.h>
+#endif
+
+#ifdef SSAM_SSE
+int CollisionKernel::CrossEdges(const float* cornerX, const float* cornerY, const float* batchX, const float* batchY)
+{
+	const int allCrossed = (1 << BATCH_SIZE) - 1;
+	const __m128 signBit = _mm_set1_ps(-0.0f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	int crossed = 0;
+	for(int k = 0; k < 4; k++)
+	{
+		int kNext = (k+1)%4;
+		// the edge of the footprint is the same in all lanes
+		__m128 p0x = _mm_set1_ps(cornerX[k]);
+		__m128 p0y = _mm_set1_ps(cornerY[k]);
+		__m128 s1x = _mm_set1_ps(cornerX[kNext] - cornerX[k]);
+		__m128 s1y = _mm_set1_ps(cornerY[kNext] - cornerY[k]);
+		__m128 negS1y = _mm_xor_ps(s1y, signBit);
+		for(int l = 0; l < 4; l++)
+		{
+			int lNext = (l+1)%4;
+			__m128 p2x = _mm_loadu_ps(batchX + BATCH_SIZE*l);
+			__m128 p2y = _mm_loadu_ps(batchY + BATCH_SIZE*l);
+			__m128 s2x = _mm_sub_ps(_mm_loadu_ps(batchX + BATCH_SIZE*lNext), p2x);
+			__m128 s2y = _mm_sub_ps(_mm_loadu_ps(batchY + BATCH_SIZE*lNext), p2y);
+			__m128 dx = _mm_sub_ps(p0x, p2x);
+			__m128 dy = _mm_sub_ps(p0y, p2y);
+
+			// s = (-s1_y * (p0_x - p2_x) + s1_x * (p0_y - p2_y)) / (-s2_x * s1_y + s1_x * s2_y)
+			// t = ( s2_x * (p0_y - p2_y) - s2_y * (p0_x - p2_x)) / (-s2_x * s1_y + s1_x * s2_y)
+			__m128 denom = _mm_add_ps(_mm_mul_ps(_mm_xor_ps(s2x, signBit), s1y), _mm_mul_ps(s1x, s2y));
+			__m128 s = _mm_div_ps(_mm_add_ps(_mm_mul_ps(negS1y, dx), _mm_mul_ps(s1x, dy)), denom);
+			__m128 t = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(s2x, dy), _mm_mul_ps(s2y, dx)), denom);
+			__m128 hit = _mm_and_ps(
+				_mm_and_ps(_mm_cmpge_ps(s, zero), _mm_cmple_ps(s, one)),
+				_mm_and_ps(_mm_cmpge_ps(t, zero), _mm_cmple_ps(t, one)));
+			crossed |= _mm_movemask_ps(hit);
+		}
+		if(crossed == allCrossed)
+			break;
+	}
+	return crossed;
+}
+#else
+int CollisionKernel::CrossEdges(const float* cornerX, const float* cornerY, const float* batchX, const float* batchY)
+{
+	int crossed = 0;
+	for(int b = 0; b < BATCH_SIZE; b++)
+	{
+		for(int k = 0; k < 4 && !(crossed & (1 << b)); k++)
+		{
+			int kNext = (k+1)%4;
+			for(int l = 0; l < 4; l++)
+			{
+				int lNext = (l+1)%4;
+				if(CheckLinesIntersect(	cornerX[k], 
+											cornerY[k], 
+											cornerX[kNext], 
+											cornerY[kNext],
+											batchX[BATCH_SIZE*l + b], 
+											batchY[BATCH_SIZE*l + b], 
+											batchX[BATCH_SIZE*lNext + b], 
+											batchY[BATCH_SIZE*lNext + b]))
+				{
+					crossed |= 1 << b;
+					break;
+				}
+			}
+		}
+	}
+	return crossed;
+}
+#endif
@@ -0,0 +1,159 @@
+/*------------------------------------------------------------------------------
+   Copyright  2016-2017
+   New Global Systems for Intelligent Transportation Management Corp.
+
+   This file is part of SSAM.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Affero General Public License as
+   published by the Free Software Foundation, either version 3 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------------*/
+#include "stdafx.h"
+#include "ConflictSink.h"
+
+AsyncConflictSink::AsyncConflictSink(SP_ConflictSink pSink, size_t capacity)
+	: m_pSink(pSink)
+	, m_Capacity(capacity)
+{
+	if (m_pSink == NULL)
+		throw SSAMException("AsyncConflictSink requires a sink to forward conflicts to.");
+}
+
+AsyncConflictSink::~AsyncConflictSink()
+{
+	Stop();
+}
+
+void AsyncConflictSink::OnConflict(SP_Conflict c)
+{
+	// the writer thread is started by the first conflict after a flush
+	if (m_pQueue == NULL)
+	{
+		m_pQueue.reset(new BoundedQueue<SP_Conflict>(m_Capacity));
+		BoundedQueue<SP_Conflict>* pQueue = m_pQueue.get();
+		m_Writer = std::thread([this, pQueue]()
+		{
+			SP_Conflict c;
+			while (pQueue->Pop(c))
+			{
+				// after an error the remaining conflicts are dropped, so the analysis is not blocked
+				if (m_WriteError)
+					continue;
+				try
+				{
+					m_pSink->OnConflict(c);
+				} catch (...)
+				{
+					m_WriteError = std::current_exception();
+				}
+			}
+		});
+	}
+	m_pQueue->Push(c);
+}
+
+void AsyncConflictSink::Flush()
+{
+	Stop();
+	if (m_WriteError)
+	{
+		std::exception_ptr writeError = m_WriteError;
+		m_WriteError = NULL;
+		std::rethrow_exception(writeError);
+	}
+	m_pSink->Flush();
+}
+
+void AsyncConflictSink::Stop()
+{
+	if (m_pQueue == NULL)
+		return;
+	m_pQueue->Close();
+	m_Writer.join();
+	m_pQueue.reset();
+}
+
+CsvConflictSink::CsvConflictSink(const std::string& csvFileName)
+	: m_CsvFileName(csvFileName)
+	, m_CsvFile(csvFileName.c_str())
+	, m_NConflicts(0)
+{
+	if (!m_CsvFile)
+		throw SSAMException("File \"" + csvFileName + "\" could not be created.");
+	m_CsvFile << std::fixed;
+	m_CsvFile << "Conflict Listing\n";
+	WriteListingLabels(m_CsvFile);
+}
+
+void CsvConflictSink::OnConflict(SP_Conflict c)
+{
+	WriteListingRow(m_CsvFile, *c);
+	m_NConflicts++;
+}
+
+void CsvConflictSink::Flush()
+{
+	m_CsvFile.flush();
+	if (!m_CsvFile)
+		throw SSAMException("File \"" + m_CsvFileName + "\" could not be written.");
+}
+
+void CsvConflictSink::WriteListingLabels(std::ostream& os)
+{
+	os << "Time (min TTC),X (min PET), Y (min PET),Z (min PET), ConflictType, FristVID,SecondVID,TTC,PET,MaxS,DeltaS,DR,MaxD,xFirstCSP,yFirstCSP,xFirstCEP,yFirstCEP,xSecondCSP,ySecondCSP,xSecondCEP,ySecondCEP\n";
+}
+
+void CsvConflictSink::WriteListingRow(std::ostream& os, const Conflict& c)
+{
+	os<<c.tMinTTC;
+	os<<",";
+	os<<c.xMinPET;
+	os<<",";
+	os<<c.yMinPET;
+	os<<",";
+	os<<c.zMinPET;
+	os<<",";
+	os<<Conflict::CONFLICT_TYPE_LABEL[c.ConflictType];
+	os<<",";
+	os<<c.FirstVID;
+	os<<",";
+	os<<c.SecondVID;
+	os<<",";
+	os<<c.TTC;
+	os<<",";
+	os<<c.PET;
+	os<<",";
+	os<<c.MaxS;
+	os<<",";
+	os<<c.DeltaS;
+	os<<",";
+	os<<c.DR;
+	os<<",";
+	os<<c.MaxD;
+	os<<",";
+	os<<c.xFirstCSP;
+	os<<",";
+	os<<c.yFirstCSP;
+	os<<",";
+	os<<c.xFirstCEP;
+	os<<",";
+	os<<c.yFirstCEP;
+	os<<",";
+	os<<c.xSecondCSP;
+	os<<",";
+	os<<c.ySecondCSP;
+	os<<",";
+	os<<c.xSecondCEP;
+	os<<",";
+	os<<c.ySecondCEP;
+	os<<"\n";
+}
@@ -0,0 +1,275 @@
+/*------------------------------------------------------------------------------
+   Copyright  2016-2017
+   New Global Systems for Intelligent Transportation Management Corp.
+
+   This file is part of SSAM.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Affero General Public License as
+   published by the Free Software Foundation, either version 3 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------------*/
+#include "stdafx.h"
+#include <cstdio>
+#include <algorithm>
+#include "ConflictStore.h"
+
+namespace
+{
+	/** SpilledConflict is the fixed-size record of a conflict in the spill file
+	*/
+	struct SpilledConflict
+	{
+		int trjFile; /*!< Index of the string in the string table */
+		float tMinTTC;
+		float xMinPET;
+		float yMinPET;
+		float zMinPET;
+		float TTC;
+		float PET;
+		float MaxS;
+		float DeltaS;
+		float DR;
+		float MaxD;
+		float MaxDeltaV;
+		float ConflictAngle;
+		int ClockAngle; /*!< Index of the string in the string table */
+		int ConflictType;
+		float PostCrashV;
+		float PostCrashHeading;
+		int FirstVID;
+		int FirstLink;
+		int FirstLane;
+		float FirstLength;
+		float FirstWidth;
+		float FirstHeading;
+		float FirstVMinTTC;
+		float FirstDeltaV;
+		float xFirstCSP;
+		float yFirstCSP;
+		float xFirstCEP;
+		float yFirstCEP;
+		int SecondVID;
+		int SecondLink;
+		int SecondLane;
+		float SecondLength;
+		float SecondWidth;
+		float SecondHeading;
+		float SecondVMinTTC;
+		float SecondDeltaV;
+		float xSecondCSP;
+		float ySecondCSP;
+		float xSecondCEP;
+		float ySecondCEP;
+		float PUEA;
+		float mTTC;
+		float mPET;
+	};
+
+	const size_t READ_BLOCK_SIZE = 4096; /*!< Number of records read from the spill file at once */
+
+	// a list node and the shared pointer control block of a conflict kept in memory
+	const size_t CONFLICT_OVERHEAD = 2 * sizeof(void*) + 4 * sizeof(void*);
+}
+
+ConflictStore::ConflictStore()
+	: m_MemoryBudget(0)
+	, m_SpillFileName("SSAMConflicts.spill")
+	, m_MemoryBytes(0)
+	, m_NSpilled(0)
+{
+}
+
+ConflictStore::~ConflictStore()
+{
+	Clear();
+}
+
+size_t ConflictStore::GetConflictBytes(const Conflict& c)
+{
+	return sizeof(Conflict) + CONFLICT_OVERHEAD + c.trjFile.capacity() + c.ClockAngle.capacity();
+}
+
+void ConflictStore::Add(SP_Conflict c)
+{
+	m_Conflicts.push_back(c);
+	m_MemoryBytes += GetConflictBytes(*c);
+	if (m_MemoryBudget > 0 && m_MemoryBytes > m_MemoryBudget)
+		Spill();
+}
+
+int ConflictStore::GetStringIndex(const std::string& s)
+{
+	std::map<std::string, int>::iterator it = m_StringIndexes.find(s);
+	if (it != m_StringIndexes.end())
+		return it->second;
+	int index = (int)m_Strings.size();
+	m_Strings.push_back(s);
+	m_StringIndexes[s] = index;
+	return index;
+}
+
+void ConflictStore::Spill()
+{
+	if (!m_SpillFile.is_open())
+	{
+		m_SpillFile.open(m_SpillFileName.c_str(), std::ios::binary | std::ios::trunc);
+		if (!m_SpillFile)
+			throw SSAMException("File \"" + m_SpillFileName + "\" could not be created.");
+	}
+
+	std::vector<SpilledConflict> records(m_Conflicts.size());
+	size_t i = 0;
+	for (std::list<SP_Conflict>::const_iterator it = m_Conflicts.begin(); it != m_Conflicts.end(); ++it, ++i)
+	{
+		const Conflict& c = **it;
+		SpilledConflict& r = records[i];
+		r.trjFile = GetStringIndex(c.trjFile);
+		r.tMinTTC = c.tMinTTC;
+		r.xMinPET = c.xMinPET;
+		r.yMinPET = c.yMinPET;
+		r.zMinPET = c.zMinPET;
+		r.TTC = c.TTC;
+		r.PET = c.PET;
+		r.MaxS = c.MaxS;
+		r.DeltaS = c.DeltaS;
+		r.DR = c.DR;
+		r.MaxD = c.MaxD;
+		r.MaxDeltaV = c.MaxDeltaV;
+		r.ConflictAngle = c.ConflictAngle;
+		r.ClockAngle = GetStringIndex(c.ClockAngle);
+		r.ConflictType = c.ConflictType;
+		r.PostCrashV = c.PostCrashV;
+		r.PostCrashHeading = c.PostCrashHeading;
+		r.FirstVID = c.FirstVID;
+		r.FirstLink = c.FirstLink;
+		r.FirstLane = c.FirstLane;
+		r.FirstLength = c.FirstLength;
+		r.FirstWidth = c.FirstWidth;
+		r.FirstHeading = c.FirstHeading;
+		r.FirstVMinTTC = c.FirstVMinTTC;
+		r.FirstDeltaV = c.FirstDeltaV;
+		r.xFirstCSP = c.xFirstCSP;
+		r.yFirstCSP = c.yFirstCSP;
+		r.xFirstCEP = c.xFirstCEP;
+		r.yFirstCEP = c.yFirstCEP;
+		r.SecondVID = c.SecondVID;
+		r.SecondLink = c.SecondLink;
+		r.SecondLane = c.SecondLane;
+		r.SecondLength = c.SecondLength;
+		r.SecondWidth = c.SecondWidth;
+		r.SecondHeading = c.SecondHeading;
+		r.SecondVMinTTC = c.SecondVMinTTC;
+		r.SecondDeltaV = c.SecondDeltaV;
+		r.xSecondCSP = c.xSecondCSP;
+		r.ySecondCSP = c.ySecondCSP;
+		r.xSecondCEP = c.xSecondCEP;
+		r.ySecondCEP = c.ySecondCEP;
+		r.PUEA = c.PUEA;
+		r.mTTC = c.mTTC;
+		r.mPET = c.mPET;
+	}
+	m_SpillFile.write(reinterpret_cast<const char*>(&records[0]), records.size() * sizeof(SpilledConflict));
+	if (!m_SpillFile)
+		throw SSAMException("File \"" + m_SpillFileName + "\" could not be written.");
+	m_NSpilled += records.size();
+	m_Conflicts.clear();
+	m_MemoryBytes = 0;
+}
+
+void ConflictStore::ForEach(const std::function<void(const Conflict&)>& f)
+{
+	if (m_NSpilled > 0)
+	{
+		m_SpillFile.flush();
+		std::ifstream file(m_SpillFileName.c_str(), std::ios::binary);
+		if (!file)
+			throw SSAMException("File \"" + m_SpillFileName + "\" could not be opened.");
+
+		std::vector<SpilledConflict> records(READ_BLOCK_SIZE);
+		Conflict c;
+		size_t nRead = 0;
+		while (nRead < m_NSpilled)
+		{
+			size_t n = std::min(READ_BLOCK_SIZE, m_NSpilled - nRead);
+			if (!file.read(reinterpret_cast<char*>(&records[0]), n * sizeof(SpilledConflict)))
+				throw SSAMException("File \"" + m_SpillFileName + "\" could not be read.");
+			for (size_t i = 0; i < n; ++i)
+			{
+				const SpilledConflict& r = records[i];
+				c.trjFile = m_Strings[r.trjFile];
+				c.tMinTTC = r.tMinTTC;
+				c.xMinPET = r.xMinPET;
+				c.yMinPET = r.yMinPET;
+				c.zMinPET = r.zMinPET;
+				c.TTC = r.TTC;
+				c.PET = r.PET;
+				c.MaxS = r.MaxS;
+				c.DeltaS = r.DeltaS;
+				c.DR = r.DR;
+				c.MaxD = r.MaxD;
+				c.MaxDeltaV = r.MaxDeltaV;
+				c.ConflictAngle = r.ConflictAngle;
+				c.ClockAngle = m_Strings[r.ClockAngle];
+				c.ConflictType = r.ConflictType;
+				c.PostCrashV = r.PostCrashV;
+				c.PostCrashHeading = r.PostCrashHeading;
+				c.FirstVID = r.FirstVID;
+				c.FirstLink = r.FirstLink;
+				c.FirstLane = r.FirstLane;
+				c.FirstLength = r.FirstLength;
+				c.FirstWidth = r.FirstWidth;
+				c.FirstHeading = r.FirstHeading;
+				c.FirstVMinTTC = r.FirstVMinTTC;
+				c.FirstDeltaV = r.FirstDeltaV;
+				c.xFirstCSP = r.xFirstCSP;
+				c.yFirstCSP = r.yFirstCSP;
+				c.xFirstCEP = r.xFirstCEP;
+				c.yFirstCEP = r.yFirstCEP;
+				c.SecondVID = r.SecondVID;
+				c.SecondLink = r.SecondLink;
+				c.SecondLane = r.SecondLane;
+				c.SecondLength = r.SecondLength;
+				c.SecondWidth = r.SecondWidth;
+				c.SecondHeading = r.SecondHeading;
+				c.SecondVMinTTC = r.SecondVMinTTC;
+				c.SecondDeltaV = r.SecondDeltaV;
+				c.xSecondCSP = r.xSecondCSP;
+				c.ySecondCSP = r.ySecondCSP;
+				c.xSecondCEP = r.xSecondCEP;
+				c.ySecondCEP = r.ySecondCEP;
+				c.PUEA = r.PUEA;
+				c.mTTC = r.mTTC;
+				c.mPET = r.mPET;
+				f(c);
+			}
+			nRead += n;
+		}
+	}
+
+	for (std::list<SP_Conflict>::const_iterator it = m_Conflicts.begin(); it != m_Conflicts.end(); ++it)
+		f(**it);
+}
+
+void ConflictStore::Clear()
+{
+	m_Conflicts.clear();
+	m_MemoryBytes = 0;
+	m_Strings.clear();
+	m_StringIndexes.clear();
+	if (m_SpillFile.is_open())
+	{
+		m_SpillFile.close();
+		std::remove(m_SpillFileName.c_str());
+	}
+	m_SpillFile.clear();
+	m_NSpilled = 0;
+}
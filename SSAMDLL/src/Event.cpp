@@ -20,39 +20,52 @@
 #include "stdafx.h"
 #include "Event.h"
 #include "Conflict.h"
+#include "TTCSolver.h"
 #include <cmath>
 
 const float Event::INVALID_SSM_VALUE = 99.0;
+const float Event::TTC_STEP_SIZE = 0.1;
 
 Event::Event(const InitEventParams& params)
-	: tMinTTC ( -1)
-	, TTC ( INVALID_SSM_VALUE)
-	, PET ( INVALID_SSM_VALUE)
-	, MaxS(0)
-	, DR ( INVALID_SSM_VALUE)	
-	, MaxD ( INVALID_SSM_VALUE)
-	, FirstVID (-1)
-	, SecondVID (-1)
-	, PUEA (1.0)
-	, mTTC(INVALID_SSM_VALUE)
-	, mPET(INVALID_SSM_VALUE)
-	, m_LastTTCIdx (-1)
-	, m_LastPETIdx (-1)
-	, m_IsActive ( true)		
-	, m_IsConflict ( false)
-	, m_IsPETComplete ( false)	
-	, m_IsCalculatePUEA (params.m_IsCalcPUEA)
-	, m_MaxTTC( params.m_MaxTTC)
-	, m_MaxPET( params. m_MaxPET)
-	, m_RearEndAngle (params.m_RearEndAngleThreshold)
-	, m_CrossingAngle (params.m_CrossingAngleThreshold)
-	, m_NSteps (params.m_NSteps)
-	, m_CollisionThreshold (params.m_CollisionThreshold)
-	, m_pNormalAdaption(params.m_pNormalAdaption)
-	, m_pEvasiveAction(params.m_pEvasiveAction)
 {
-	int id1 = params.m_V1->GetVehicleID();
-	int id2 = params.m_V2->GetVehicleID();
+	Reset(params);
+}
+
+void Event::Reset(const InitEventParams& params)
+{
+	tMinTTC = -1;
+	TTC = INVALID_SSM_VALUE;
+	PET = INVALID_SSM_VALUE;
+	MaxS = 0;
+	DR = INVALID_SSM_VALUE;
+	MaxD = INVALID_SSM_VALUE;
+	ClockAngleString.clear();
+	FirstVID = -1;
+	SecondVID = -1;
+	PUEA = 1.0;
+	mTTC = INVALID_SSM_VALUE;
+	mPET = INVALID_SSM_VALUE;
+	m_LastTTC = 0;
+	m_FirstPET = 0;
+	m_LastPET = 0;
+	m_LastTTCIdx = -1;
+	m_LastPETIdx = -1;
+	m_IsActive = true;
+	m_IsConflict = false;
+	m_IsPETComplete = false;
+	m_IsCalculatePUEA = params.m_IsCalcPUEA;
+	m_TTCEngine = params.m_TTCEngine;
+	m_MaxTTC = params.m_MaxTTC;
+	m_MaxPET = params.m_MaxPET;
+	m_RearEndAngle = params.m_RearEndAngleThreshold;
+	m_CrossingAngle = params.m_CrossingAngleThreshold;
+	m_NSteps = params.m_NSteps;
+	m_CollisionThreshold = params.m_CollisionThreshold;
+	m_pNormalAdaption = params.m_pNormalAdaption;
+	m_pEvasiveAction = params.m_pEvasiveAction;
+
+	int id1 = params.m_pV1->GetVehicleID();
+	int id2 = params.m_pV2->GetVehicleID();
 	if(id1 == id2)
 		throw SSAMException("Event cannot be instantiated with two vehicles with the same ID.");		
 	if(id1 < id2)
@@ -66,97 +79,96 @@ Event::Event(const InitEventParams& params)
 		m_HighVID = id1;
 	}
 		
-	AddVehicleData(params.m_V1, params.m_V2);
+	// a reused event keeps the memory of its vehicle data
+	m_LowVData.clear();
+	m_HighVData.clear();
+	AddVehicleData(*params.m_pV1, *params.m_pV2);
 				
 	m_FirstTTC = m_PreTimeStep;
 	m_IsActive = true;
 
-	m_StepSize = 0.1;
+	m_StepSize = TTC_STEP_SIZE;
 	m_TotalSteps = m_MaxTTC / m_StepSize + 1;
 }
 
-void Event::AddVehicleData(SP_Vehicle v1, SP_Vehicle v2)
+int Event::GetNTTCs(float maxTTC)
+{
+	int n = 0;
+	for(float ttc = maxTTC; ttc > -0.01; ttc -= TTC_STEP_SIZE)
+	{
+		if(ttc < 0)
+			ttc = 0;
+		n++;
+	}
+	return n;
+}
+
+void Event::AddVehicleData(const Vehicle& v1, const Vehicle& v2)
 {
-	if(v1->GetTimeStep() != v2->GetTimeStep()) 
+	if(v1.GetTimeStep() != v2.GetTimeStep()) 
 		throw SSAMException("Event will not accept two vehicles from different time steps.");
 
 	int size = m_LowVData.size();
 	if(size > 0)
 	{
-		SP_Vehicle vLast = m_LowVData[size - 1];
-		if(v1->GetTimeStep() <= vLast->GetTimeStep()) 
-			throw SSAMException("New event data is not in chronolical order: (new timestep data) " + std::to_string(v1->GetTimeStep()) + " <= " + std::to_string(vLast->GetTimeStep()) + " (old timestep data)");
+		const Vehicle& vLast = m_LowVData[size - 1];
+		if(v1.GetTimeStep() <= vLast.GetTimeStep()) 
+			throw SSAMException("New event data is not in chronolical order: (new timestep data) " + std::to_string(v1.GetTimeStep()) + " <= " + std::to_string(vLast.GetTimeStep()) + " (old timestep data)");
 	}
 		
-	if(v1->GetVehicleID() < v2->GetVehicleID())
+	if(v1.GetVehicleID() < v2.GetVehicleID())
 	{
-		if(m_LowVID != v1->GetVehicleID() || m_HighVID != v2->GetVehicleID())
+		if(m_LowVID != v1.GetVehicleID() || m_HighVID != v2.GetVehicleID())
 			throw SSAMException ("Tried to add incompatible data to an Event object.");
 		m_LowVData.push_back(v1);
 		m_HighVData.push_back(v2);
 	}
 	else
 	{
-		if(m_LowVID != v2->GetVehicleID() || m_HighVID != v1->GetVehicleID())
+		if(m_LowVID != v2.GetVehicleID() || m_HighVID != v1.GetVehicleID())
 			throw SSAMException ("Tried to add incompatible data to an Event object.");
 		m_LowVData.push_back(v2);
 		m_HighVData.push_back(v1);
 	}
 		
-	m_PreTimeStep = v1->GetTimeStep();
+	m_PreTimeStep = v1.GetTimeStep();
 }
 
-bool Event::AnalyzeData(float tCurrent) 
+bool Event::AnalyzeData(float tCurrent, const StepWindow& window, ProjectionCache& projections) 
 {			
 	int iLast = m_LowVData.size()-1;
 	if (iLast < 0 || m_LowVData.size() != m_HighVData.size())
 		return false;
 
-	SP_Vehicle vLo = m_LowVData[iLast];
-	SP_Vehicle vHi = m_HighVData[iLast];
-	while(m_PreTimeStep < tCurrent)
+	if(m_PreTimeStep < tCurrent)
 	{
-		vLo = vLo->GetNext();
-		vHi = vHi->GetNext();
+		// the last data is of the time step before the first time step of the window
+		int iLoNext = m_LowVData[iLast].GetNextIndex();
+		int iHiNext = m_HighVData[iLast].GetNextIndex();
 		
-		if(vLo == NULL || vHi == NULL)
+		if(iLoNext < 0 || iHiNext < 0 || window.empty())
 		{
 			m_IsActive = false;
 			m_IsConflict = false;
 			return false;
 		}
 		
-		AddVehicleData(vLo, vHi);
+		AddVehicleData(*(*window[0])[iLoNext], *(*window[0])[iHiNext]);
 		iLast++;
 	}
+	const Vehicle* vLo = &m_LowVData[iLast];
+	const Vehicle* vHi = &m_HighVData[iLast];
 		
 	if(m_IsActive)
 	{
-		SP_Vehicle vLoProj;
-		SP_Vehicle vHiProj;
-		bool isCollision = false;
 		float stepTTC = INVALID_SSM_VALUE;
-		for(float ttc = m_MaxTTC; ttc > -0.01; ttc -= m_StepSize)
-		{
-			if(ttc < 0)
-				ttc = 0;
-					
-			vLoProj = vLo->CalcProjection(ttc, m_MaxPET);
-			vHiProj = vHi->CalcProjection(ttc, m_MaxPET);
-			if(vLoProj->IsCollided(vHiProj))
-			{
-				isCollision = true;
-				stepTTC = ttc;
-				m_LastTTC = tCurrent;
-				m_LastTTCIdx = iLast;	
-			}
-			else if(isCollision)
-			{
-				break;
-			}
-		}
+		bool isCollision = (m_TTCEngine == CONTINUOUS_TTC)
+			? SolveTTC(*vLo, *vHi, projections, stepTTC)
+			: SweepTTC(*vLo, *vHi, projections, stepTTC);
 		if(isCollision)
 		{
+			m_LastTTC = tCurrent;
+			m_LastTTCIdx = iLast;	
 			if(stepTTC < TTC)
 			{
 				TTC = stepTTC;
@@ -181,65 +193,73 @@ bool Event::AnalyzeData(float tCurrent)
 
 	if(!m_IsPETComplete && (PET == INVALID_SSM_VALUE || SecondVID == m_HighVID))
 	{
-		SP_Vehicle vLoPrev;
-		for(int i = std::max(0, m_LastPETIdx + 1); i <= iLast && i <= m_LastTTCIdx; i++)
+		// the vehicle data are tested in batches, and the collided ones are visited in order
+		int iFirst = std::max(0, m_LastPETIdx + 1);
+		int iEnd = std::min(iLast, m_LastTTCIdx);
+		std::vector<int> crashes;
+		if(iFirst <= iEnd)
+			vHi->FindCollisions(&m_LowVData[iFirst], iEnd - iFirst + 1, crashes);
+		const Vehicle* vLoPrev;
+		for(size_t c = 0; c < crashes.size(); c++)
 		{
-			vLoPrev = m_LowVData[i];
-			if(vHi->IsCollided(vLoPrev))
+			int i = iFirst + crashes[c];
+			vLoPrev = &m_LowVData[i];
+			float pet = vHi->GetTimeStep() - vLoPrev->GetTimeStep();
+			if(pet < 0)
+				pet = 0;
+			if(pet < PET)
 			{
-				float pet = vHi->GetTimeStep() - vLoPrev->GetTimeStep();
-				if(pet < 0)
-					pet = 0;
-				if(pet < PET)
-				{
-					PET = pet;
+				PET = pet;
 
-					xMinPET = vLoPrev->GetCenterX();
-					yMinPET = vLoPrev->GetCenterY();
-					zMinPET = vLoPrev->GetCenterZ();
-						
-					if(PET < 0.01)
-						m_IsPETComplete = true;
-					FirstVID = m_LowVID;
-					SecondVID = m_HighVID;
-					m_LastPETIdx = i;					
-				}
-				
-				if(m_FirstPET <= 0)
-					m_FirstPET = tCurrent;
-				m_LastPET = tCurrent;
+				xMinPET = vLoPrev->GetCenterX();
+				yMinPET = vLoPrev->GetCenterY();
+				zMinPET = vLoPrev->GetCenterZ();
+					
+				if(PET < 0.01)
+					m_IsPETComplete = true;
+				FirstVID = m_LowVID;
+				SecondVID = m_HighVID;
+				m_LastPETIdx = i;					
 			}
+			
+			if(m_FirstPET <= 0)
+				m_FirstPET = tCurrent;
+			m_LastPET = tCurrent;
 		}
 	}
 	if(!m_IsPETComplete && (PET == INVALID_SSM_VALUE || SecondVID == m_LowVID))
 	{
-		SP_Vehicle vHiPrev;
-		for(int i = std::max(0, m_LastPETIdx + 1); i <= iLast && i <= m_LastTTCIdx; i++)
+		// the vehicle data are tested in batches, and the collided ones are visited in order
+		int iFirst = std::max(0, m_LastPETIdx + 1);
+		int iEnd = std::min(iLast, m_LastTTCIdx);
+		std::vector<int> crashes;
+		if(iFirst <= iEnd)
+			vLo->FindCollisions(&m_HighVData[iFirst], iEnd - iFirst + 1, crashes);
+		const Vehicle* vHiPrev;
+		for(size_t c = 0; c < crashes.size(); c++)
 		{
-			vHiPrev = m_HighVData[i];
-			if(vLo->IsCollided(vHiPrev))
+			int i = iFirst + crashes[c];
+			vHiPrev = &m_HighVData[i];
+			float pet = vLo->GetTimeStep() - vHiPrev->GetTimeStep();
+			if(pet < 0)
+				pet = 0;
+			if(pet < PET)
 			{
-				float pet = vLo->GetTimeStep() - vHiPrev->GetTimeStep();
-				if(pet < 0)
-					pet = 0;
-				if(pet < PET)
-				{
-					PET = pet;
+				PET = pet;
+				
+				xMinPET = vHiPrev->GetCenterX();
+				yMinPET = vHiPrev->GetCenterY();
+				zMinPET = vHiPrev->GetCenterZ();
 					
-					xMinPET = vHiPrev->GetCenterX();
-					yMinPET = vHiPrev->GetCenterY();
-					zMinPET = vHiPrev->GetCenterZ();
-						
-					if(PET < 0.01)
-						m_IsPETComplete = true;
-					FirstVID = m_HighVID;
-					SecondVID = m_LowVID;
-					m_LastPETIdx = i;					
-				}
-				if(m_FirstPET <= 0)
-					m_FirstPET = tCurrent;
-				m_LastPET = tCurrent;
+				if(PET < 0.01)
+					m_IsPETComplete = true;
+				FirstVID = m_HighVID;
+				SecondVID = m_LowVID;
+				m_LastPETIdx = i;					
 			}
+			if(m_FirstPET <= 0)
+				m_FirstPET = tCurrent;
+			m_LastPET = tCurrent;
 		}
 	}
 	if(!m_IsActive)
@@ -261,19 +281,50 @@ bool Event::AnalyzeData(float tCurrent)
 	return true;
 }
 
+bool Event::SweepTTC(const Vehicle& vLo, const Vehicle& vHi, ProjectionCache& projections, float& stepTTC)
+{
+	bool isCollision = false;
+	int k = 0;
+	for(float ttc = m_MaxTTC; ttc > -0.01; ttc -= m_StepSize, k++)
+	{
+		if(ttc < 0)
+			ttc = 0;
+				
+		size_t iLo = projections.GetProjection(vLo, k, ttc, m_MaxPET);
+		size_t iHi = projections.GetProjection(vHi, k, ttc, m_MaxPET);
+		if(projections.GetShapes().IsCollided(iLo, iHi))
+		{
+			isCollision = true;
+			stepTTC = ttc;
+		}
+		else if(isCollision)
+		{
+			break;
+		}
+	}
+	return isCollision;
+}
+
+bool Event::SolveTTC(const Vehicle& vLo, const Vehicle& vHi, ProjectionCache& projections, float& ttc)
+{
+	const std::vector<PathPiece>& pathLo = projections.GetPath(vLo, m_MaxTTC, m_MaxPET);
+	const std::vector<PathPiece>& pathHi = projections.GetPath(vHi, m_MaxTTC, m_MaxPET);
+	return TTCSolver::FindFirstContact(pathLo, pathHi, ttc);
+}
+
 void Event::CalcMeasures()
 {
 	if(SecondVID >= 0)
 	{
-		std::vector<SP_Vehicle>* secPos = &m_LowVData;
+		std::vector<Vehicle>* secPos = &m_LowVData;
 		if(SecondVID == m_HighVID)
 			secPos = &m_HighVData;
-		std::vector<SP_Vehicle>::iterator i = secPos->begin();
+		std::vector<Vehicle>::iterator i = secPos->begin();
 		float AR;
 		float minAR = INVALID_SSM_VALUE;
 		for(; i != secPos->end(); ++i)
 		{
-			SP_Vehicle secVeh = *i;
+			const Vehicle* secVeh = &*i;
 			if(secVeh->GetTimeStep() > m_LastPET)
 				break;
 			AR = secVeh->GetAcceleration();
@@ -287,17 +338,17 @@ void Event::CalcMeasures()
 		MaxD = minAR;
 	}
 		
-	std::vector<SP_Vehicle>* firstPos = &m_LowVData;
-	std::vector<SP_Vehicle>* secPos   = &m_HighVData;
+	std::vector<Vehicle>* firstPos = &m_LowVData;
+	std::vector<Vehicle>* secPos   = &m_HighVData;
 	if(FirstVID == m_HighVID)
 	{
 		firstPos = &m_HighVData;
 		secPos   = &m_LowVData;
 	}
-	std::vector<SP_Vehicle>::iterator fit = firstPos->begin();
-	std::vector<SP_Vehicle>::iterator sit = secPos->begin();
-	SP_Vehicle v1st = NULL;
-	SP_Vehicle v2nd = NULL;
+	std::vector<Vehicle>::iterator fit = firstPos->begin();
+	std::vector<Vehicle>::iterator sit = secPos->begin();
+	const Vehicle* v1st = NULL;
+	const Vehicle* v2nd = NULL;
 	float t = 0;
 	float m1 = 1;	//	Surrogate mass measure for the first vehicle
 	float m2 = 1;	//	Surrogate mass measure for the second vehicle
@@ -308,8 +359,8 @@ void Event::CalcMeasures()
 		
 	for(; fit != firstPos->end() && sit!= secPos->end(); ++fit, ++sit)
 	{
-		v1st = *fit;
-		v2nd = *sit;
+		v1st = &*fit;
+		v2nd = &*sit;
 		t = v1st->GetTimeStep();
 		if(t == m_FirstTTC)
 		{
@@ -483,15 +534,23 @@ void Event::CalcMeasures()
 		using namespace MotPredNameSpace;
 		PredObj obj1 = {point(xFirstCSP, yFirstCSP), point(vx1, vy1)};
 		PredObj obj2 = {point(xSecondCSP, ySecondCSP), point(vx2, vy2)};
+
+		// the trajectories of an event are drawn from its own random numbers, seeded by the pair of vehicles
+		// and the time step the event starts, so that events can be analyzed in any order and on any thread
+		unsigned int seeds[3] = {(unsigned int)m_LowVID, (unsigned int)m_HighVID, (unsigned int)(long long)floor(m_FirstTTC * 1000 + 0.5)};
+		std::seed_seq seedSeq(seeds, seeds + 3);
+		RandomEngine random(seedSeq);
 		
 		m_pNormalAdaption->CalcMTTCMPET(obj1, obj2, 
 			m_CollisionThreshold,
 			m_TotalSteps,
+			random,
 			mTTC, mPET);
 
 		PUEA = m_pEvasiveAction->CalcPUEA(obj1,
 			obj2,
 			m_CollisionThreshold, 
-			m_TotalSteps);
+			m_TotalSteps,
+			random);
 	}		
 }
@@ -0,0 +1,174 @@
+/*------------------------------------------------------------------------------
+   Copyright  2016-2017
+   New Global Systems for Intelligent Transportation Management Corp.
+
+   This file is part of SSAM.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Affero General Public License as
+   published by the Free Software Foundation, either version 3 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------------*/
+#include "stdafx.h"
+#include <algorithm>
+#include "EventTable.h"
+
+namespace
+{
+	/** PairLess orders the slots of the pool of events by the pairs of vehicle IDs of the events
+	*/
+	struct PairLess
+	{
+		explicit PairLess(const std::vector<std::pair<int, int> >& pairs) : m_pPairs(&pairs) {}
+
+		bool operator()(int a, int b) const
+		{
+			return (*m_pPairs)[a] < (*m_pPairs)[b];
+		}
+
+		const std::vector<std::pair<int, int> >* m_pPairs; /*!< Pairs of vehicle IDs of the events, by slot */
+	};
+
+	/** Find the home entry of a key in a hash table.
+	 * @param key the key
+	 * @param mask number of entries of the table minus one
+	 * @return index of the entry
+	 */
+	size_t HashKey(unsigned long long key, size_t mask)
+	{
+		return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+	}
+}
+
+EventTable::EventTable()
+	: m_NEvents(0)
+{
+	Rehash(64);
+}
+
+size_t EventTable::FindEntry(unsigned long long key) const
+{
+	size_t mask = m_Keys.size() - 1;
+	size_t i = HashKey(key, mask);
+	while (m_Keys[i] != key && m_Keys[i] != EMPTY_KEY)
+		i = (i + 1) & mask;
+	return i;
+}
+
+Event* EventTable::Find(int lowID, int highID) const
+{
+	size_t i = FindEntry(PackPair(lowID, highID));
+	if (m_Keys[i] == EMPTY_KEY)
+		return NULL;
+	return m_Events[m_Slots[i]].get();
+}
+
+void EventTable::Add(int lowID, int highID, const InitEventParams& params)
+{
+	// the table is kept at most half full
+	if (2 * (m_NEvents + 1) > m_Keys.size())
+		Rehash(2 * m_Keys.size());
+
+	unsigned long long key = PackPair(lowID, highID);
+	size_t i = FindEntry(key);
+	if (m_Keys[i] != EMPTY_KEY)
+		throw SSAMException("Conflict event is added twice for the same pair of vehicles.");
+
+	//	a free event of the pool is reused, and stays free if the event cannot be started
+	if (m_FreeSlots.empty())
+	{
+		m_FreeSlots.push_back((int)m_Events.size());
+		m_Events.push_back(std::make_shared<Event>());
+		m_Pairs.push_back(std::pair<int, int>());
+	}
+	int slot = m_FreeSlots.back();
+	m_Events[slot]->Reset(params);
+	m_FreeSlots.pop_back();
+	m_Pairs[slot] = std::pair<int, int>(lowID, highID);
+	m_Keys[i] = key;
+	m_Slots[i] = slot;
+	m_Added.push_back(slot);
+	++m_NEvents;
+}
+
+void EventTable::Order()
+{
+	if (m_Added.empty())
+		return;
+	PairLess less(m_Pairs);
+	std::sort(m_Added.begin(), m_Added.end(), less);
+	size_t nOrdered = m_Order.size();
+	m_Order.insert(m_Order.end(), m_Added.begin(), m_Added.end());
+	std::inplace_merge(m_Order.begin(), m_Order.begin() + nOrdered, m_Order.end(), less);
+	m_Added.clear();
+}
+
+void EventTable::Remove(size_t k)
+{
+	int slot = m_Order[k];
+	const std::pair<int, int>& pair = m_Pairs[slot];
+	size_t i = FindEntry(PackPair(pair.first, pair.second));
+
+	//	the entries after the removed one that cannot be found past the gap are shifted back into it
+	size_t mask = m_Keys.size() - 1;
+	size_t j = i;
+	for (;;)
+	{
+		j = (j + 1) & mask;
+		if (m_Keys[j] == EMPTY_KEY)
+			break;
+		size_t home = HashKey(m_Keys[j], mask);
+		bool isBetween = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+		if (!isBetween)
+		{
+			m_Keys[i] = m_Keys[j];
+			m_Slots[i] = m_Slots[j];
+			i = j;
+		}
+	}
+	m_Keys[i] = EMPTY_KEY;
+
+	m_FreeSlots.push_back(slot);
+	m_Order[k] = -1;
+	--m_NEvents;
+}
+
+void EventTable::Compact()
+{
+	m_Order.erase(std::remove(m_Order.begin(), m_Order.end(), -1), m_Order.end());
+}
+
+void EventTable::Clear()
+{
+	m_Keys.assign(m_Keys.size(), (unsigned long long)EMPTY_KEY);
+	m_FreeSlots.clear();
+	for (int slot = (int)m_Events.size() - 1; slot >= 0; --slot)
+		m_FreeSlots.push_back(slot);
+	m_Order.clear();
+	m_Added.clear();
+	m_NEvents = 0;
+}
+
+void EventTable::Rehash(size_t nEntries)
+{
+	std::vector<unsigned long long> keys(nEntries, (unsigned long long)EMPTY_KEY);
+	std::vector<int> slots(nEntries);
+	keys.swap(m_Keys);
+	slots.swap(m_Slots);
+	for (size_t i = 0; i < keys.size(); ++i)
+	{
+		if (keys[i] == EMPTY_KEY)
+			continue;
+		size_t j = FindEntry(keys[i]);
+		m_Keys[j] = keys[i];
+		m_Slots[j] = slots[i];
+	}
+}
@@ -105,14 +105,15 @@ bool PredMethod::DetectCrossingZone(SP_PredTraj pTrj1, SP_PredTraj pTrj2,
 }
 
 void NormalAdaption::GenPredTrajs(const PredObj& obj,
-		std::vector<SP_PredTraj>& predTrajs)
+		std::vector<SP_PredTraj>& predTrajs,
+		RandomEngine& random)
 {
 	predTrajs.clear();
 	PredTrajFactory PTF;
 	for (int i = 0; i < m_nPredTrajs; ++i)
 	{
 		SP_PredTraj pt = PTF.CreatePredTraj(NORMALADAPTION, obj, m_MaxSpeed); 
-		((PredTrajRandom*)(pt.get()))->SetDistributions(m_AccelDistri, m_SteerDistri);
+		((PredTrajRandom*)(pt.get()))->SetDistributions(m_AccelDistri, m_SteerDistri, &random);
 		predTrajs.push_back(pt);
 	}
 }
@@ -121,6 +122,7 @@ void NormalAdaption::CalcMTTCMPET(const PredObj& obj1,
 		const PredObj& obj2, 
 		double collisionThreshold, 
 		int nSteps,
+		RandomEngine& random,
 		float& mTTC, float& mPET)
 {
 	int nTTCs = 0;
@@ -130,8 +132,8 @@ void NormalAdaption::CalcMTTCMPET(const PredObj& obj1,
 	
 	int nCollisions = 0;
 	std::vector<SP_PredTraj> predTrajs1, predTrajs2;
-	GenPredTrajs(obj1, predTrajs1);
-	GenPredTrajs(obj2, predTrajs2);
+	GenPredTrajs(obj1, predTrajs1, random);
+	GenPredTrajs(obj2, predTrajs2, random);
 
 	int t = 0;
 	point pos1, pos2;
@@ -170,14 +172,17 @@ void NormalAdaption::CalcMTTCMPET(const PredObj& obj1,
 }
 
 void EvasiveAction::GenPredTrajs(const PredObj& obj,
-		std::vector<SP_PredTraj>& predTrajs)
+		std::vector<SP_PredTraj>& predTrajs,
+		RandomEngine& random)
 {
 	predTrajs.clear();
 	PredTrajFactory PTF;
 	for (int i = 0; i < m_nPredTrajs; ++i)
 	{
 		SP_PredTraj pt = PTF.CreatePredTraj(EVASIVEACTION, obj, m_MaxSpeed); 
-		((PredTrajConstant*)(pt.get()))->SetControl(NormAngle(m_AccelDistri(), m_SteerDistri()));
+		double accel = m_AccelDistri(random);
+		double steer = m_SteerDistri(random);
+		((PredTrajConstant*)(pt.get()))->SetControl(NormAngle(accel, steer));
 		predTrajs.push_back(pt);
 	}
 }
@@ -185,12 +190,13 @@ void EvasiveAction::GenPredTrajs(const PredObj& obj,
 float EvasiveAction::CalcPUEA(const PredObj& obj1, 
 		const PredObj& obj2, 
 		double collisionThreshold, 
-		int nSteps)
+		int nSteps,
+		RandomEngine& random)
 {
 	int nCollisions = 0;
 	std::vector<SP_PredTraj> predTrajs1, predTrajs2;
-	GenPredTrajs(obj1, predTrajs1);
-	GenPredTrajs(obj2, predTrajs2);
+	GenPredTrajs(obj1, predTrajs1, random);
+	GenPredTrajs(obj2, predTrajs2, random);
 
 	int t = 0;
 	point pos1, pos2;
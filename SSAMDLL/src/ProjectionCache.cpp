@@ -0,0 +1,110 @@
+/*------------------------------------------------------------------------------
+   Copyright  2016-2017
+   New Global Systems for Intelligent Transportation Management Corp.
+
+   This file is part of SSAM.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Affero General Public License as
+   published by the Free Software Foundation, either version 3 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------------*/
+#include "stdafx.h"
+#include "ProjectionCache.h"
+
+ProjectionCache::ProjectionCache()
+	: m_pTracks (NULL)
+	, m_NTTCs (0)
+	, m_NShapes (0)
+	, m_NPaths (0)
+	, m_NHits (0)
+	, m_NMisses (0)
+{
+}
+
+void ProjectionCache::BeginTimeStep(size_t nVehicles, const VehicleTracks& tracks, int nTTCs)
+{
+	m_pTracks = &tracks;
+	m_NTTCs = nTTCs;
+	m_Slots.assign(tracks.GetNTrackIDs() * nTTCs, -1);
+	if (m_Shapes.GetSize() < nVehicles)
+		m_Shapes.Resize(nVehicles);
+	m_NShapes = nVehicles;
+	m_PathSlots.assign(tracks.GetNTrackIDs(), -1);
+	m_NPaths = 0;
+}
+
+void ProjectionCache::ProjectVehicle(size_t iv, const Vehicle& v, float maxTTC, float maxPET)
+{
+	v.CalcProjection(maxTTC, maxPET, *m_pTracks, m_Shapes, iv);
+	if (v.GetTrack() >= 0 && m_NTTCs > 0)
+		m_Slots[(size_t)v.GetTrack() * m_NTTCs] = (int)iv;
+}
+
+size_t ProjectionCache::GetProjection(const Vehicle& v, int k, float ttc, float maxPET)
+{
+	if (v.GetTrack() < 0 || k >= m_NTTCs)
+	{
+		// a vehicle outside the window is not cached
+		size_t i = NewShape();
+		v.CalcProjection(ttc, maxPET, *m_pTracks, m_Shapes, i);
+		++m_NMisses;
+		return i;
+	}
+
+	int& slot = m_Slots[(size_t)v.GetTrack() * m_NTTCs + k];
+	if (slot >= 0)
+	{
+		++m_NHits;
+		return slot;
+	}
+	slot = (int)NewShape();
+	v.CalcProjection(ttc, maxPET, *m_pTracks, m_Shapes, slot);
+	++m_NMisses;
+	return slot;
+}
+
+const std::vector<PathPiece>& ProjectionCache::GetPath(const Vehicle& v, float maxTTC, float maxPET)
+{
+	if (v.GetTrack() >= 0)
+	{
+		int slot = m_PathSlots[v.GetTrack()];
+		if (slot >= 0)
+		{
+			++m_NHits;
+			return m_Paths[slot];
+		}
+	}
+
+	// a vehicle outside the window takes a path that is not found again
+	if (m_NPaths == m_Paths.size())
+		m_Paths.push_back(std::vector<PathPiece>());
+	std::vector<PathPiece>& path = m_Paths[m_NPaths];
+	v.CalcPath(maxTTC, maxPET, *m_pTracks, path);
+	if (v.GetTrack() >= 0)
+		m_PathSlots[v.GetTrack()] = (int)m_NPaths;
+	++m_NPaths;
+	++m_NMisses;
+	return path;
+}
+
+void ProjectionCache::AddCounts(const ProjectionCache& other)
+{
+	m_NHits += other.m_NHits;
+	m_NMisses += other.m_NMisses;
+}
+
+size_t ProjectionCache::NewShape()
+{
+	if (m_NShapes == m_Shapes.GetSize())
+		m_Shapes.Resize(2 * m_NShapes + 16);
+	return m_NShapes++;
+}
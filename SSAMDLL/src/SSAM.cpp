@@ -4,7 +4,13 @@
 #include<set>
 #include<cfloat>
 #include<cmath>
+#include<algorithm>
 #include <iomanip>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include "BoundedQueue.h"
 
 using namespace std;
 using namespace SSAMFuncs;
@@ -12,19 +18,137 @@ using namespace SSAMFuncs;
 const float SSAM::DEFAULT_TTC = 1.5; 
 const float SSAM::DEFAULT_PET = 5.0; 
 
+void TimeStepData::BuildIndex()
+{
+	if (m_IsIndexed)
+		return;
+	m_IsIndexed = true;
+	m_IsSorted = false;
+	m_IndexTable.clear();
+	m_SortedIDs.clear();
+	size_t n = m_VehicleIDs.size();
+	if (n == 0)
+		return;
+
+	// most simulators write the vehicles in ID order, which is searched without a table
+	m_IsSorted = true;
+	for (size_t i = 1; i < n && m_IsSorted; ++i)
+		m_IsSorted = (m_VehicleIDs[i - 1] < m_VehicleIDs[i]);
+	if (m_IsSorted)
+		return;
+
+	// a dense table is used as long as it is not much larger than the number of vehicles
+	int minID = *std::min_element(m_VehicleIDs.begin(), m_VehicleIDs.end());
+	int maxID = *std::max_element(m_VehicleIDs.begin(), m_VehicleIDs.end());
+	long long range = (long long)maxID - (long long)minID + 1;
+	bool hasDuplicates = false;
+	if (range <= 4 * (long long)n + 1024)
+	{
+		m_MinID = minID;
+		m_IndexTable.assign((size_t)range, -1);
+		for (size_t i = 0; i < n; ++i)
+		{
+			int& index = m_IndexTable[m_VehicleIDs[i] - minID];
+			if (index >= 0)
+				hasDuplicates = true;
+			else
+				index = (int)i;
+		}
+	} else
+	{
+		m_SortedIDs.resize(n);
+		for (size_t i = 0; i < n; ++i)
+			m_SortedIDs[i] = std::pair<int, int>(m_VehicleIDs[i], (int)i);
+		std::sort(m_SortedIDs.begin(), m_SortedIDs.end());
+		for (size_t i = 1; i < n && !hasDuplicates; ++i)
+			hasDuplicates = (m_SortedIDs[i].first == m_SortedIDs[i - 1].first);
+	}
+
+	if (hasDuplicates)
+	{
+		// keep the first data of each vehicle, which the ID table points to
+		size_t nKept = 0;
+		for (size_t i = 0; i < n; ++i)
+		{
+			if (FindVehicle(m_VehicleIDs[i]) != (int)i)
+				continue;
+			m_VehicleIDs[nKept] = m_VehicleIDs[i];
+			m_Vehicles[nKept] = m_Vehicles[i];
+			++nKept;
+		}
+		m_VehicleIDs.resize(nKept);
+		m_Vehicles.resize(nKept);
+		m_IsIndexed = false;
+		BuildIndex();
+	}
+}
+
+size_t TimeStepData::LinkNext(const TimeStepData& next)
+{
+	size_t n = m_VehicleIDs.size();
+	size_t nLinked = 0;
+	if (m_IsSorted && next.m_IsSorted)
+	{
+		size_t nNext = next.m_VehicleIDs.size();
+		size_t j = 0;
+		for (size_t i = 0; i < n; ++i)
+		{
+			int vID = m_VehicleIDs[i];
+			while (j < nNext && next.m_VehicleIDs[j] < vID)
+				++j;
+			int iNext = (j < nNext && next.m_VehicleIDs[j] == vID) ? (int)j : -1;
+			m_Vehicles[i]->SetNextIndex(iNext);
+			nLinked += (iNext >= 0);
+		}
+		return nLinked;
+	}
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		int iNext = next.FindVehicle(m_VehicleIDs[i]);
+		m_Vehicles[i]->SetNextIndex(iNext);
+		nLinked += (iNext >= 0);
+	}
+	return nLinked;
+}
+
 SSAM::SSAM()
 	: m_MaxTTC(DEFAULT_TTC)
 	, m_MaxPET(DEFAULT_PET)
 	, m_RearEndAngleThreshold(DEFAULT_REARENDANGLE)
 	, m_CrossingAngleThreshold(DEFAULT_CROSSINGANGLE)
-	, m_NThreads (1)
-	, m_IsWriteDat(false)
-	, m_IsCalcPUEA(false)
-	, m_Units(0)
-	, m_ZoneSize(50.0)
 	, m_AnalysisTime(0)
 	, m_StartTime(0)
 	, m_EndTime(0)
+	, m_IsCalcPUEA(false)
+	, m_TTCEngine(Event::SWEEP_TTC)
+	, m_Broadphase(ZONE_GRID_BROADPHASE)
+	, m_IsRetainConflicts(true)
+	, m_ReadBytes (0)
+	, m_ReadSeconds (0)
+	, m_NEnteredVehicles (0)
+	, m_NLeftVehicles (0)
+	, m_pTrjDataList (NULL)
+	, m_IsWriteDat(false)
+	, m_NThreads (1)
+	, m_PrefetchDepth (0)
+	, m_NFileWorkers (1)
+	, m_NTimeSlices (1)
+	, m_SlicePrevTimeStep (-FLT_MAX)
+	, m_SliceEndTime (FLT_MAX)
+	, m_IsRecordEvents (false)
+	, m_WindowStart (-FLT_MAX)
+	, m_WindowEnd (FLT_MAX)
+	, m_IsUseIndex (false)
+	, m_IsBuildIndex (false)
+	, m_IsUseCache (true)
+	, m_CacheStep (0)
+	, m_SweepAxis(-1)
+	, m_Units(0)
+	, m_ZoneSize(50.0)
+	, m_BaseZoneSize(50)
+	, m_NStepsToTuneZones(0)
+	, m_NZoneTunings(0)
 	, m_IsFirstTimeStep(true)
 	, m_NSteps(10)
 	, m_IsPrintProgress (false)
@@ -43,13 +167,14 @@ SSAM::~SSAM()
 
 void SSAM::Initialize()
 {
-	m_InitEventParams.m_V1 = NULL;
-	m_InitEventParams.m_V2 = NULL;
+	m_InitEventParams.m_pV1 = NULL;
+	m_InitEventParams.m_pV2 = NULL;
 	m_InitEventParams.m_MaxTTC = m_MaxTTC;
 	m_InitEventParams.m_MaxPET = m_MaxPET;
 	m_InitEventParams.m_RearEndAngleThreshold = m_RearEndAngleThreshold;
 	m_InitEventParams.m_CrossingAngleThreshold = m_CrossingAngleThreshold;
 	m_InitEventParams.m_IsCalcPUEA = m_IsCalcPUEA;
+	m_InitEventParams.m_TTCEngine = m_TTCEngine;
 	m_InitEventParams.m_NSteps = m_NSteps;
 	m_InitEventParams.m_CollisionThreshold = 0;
 	m_InitEventParams.m_pNormalAdaption = NULL;
@@ -60,6 +185,8 @@ void SSAM::Initialize()
 void SSAM::Terminate()
 {
 	CalcSummaries();
+	if (m_pConflictSink != NULL)
+		m_pConflictSink->Flush();
 	m_EndTime = std::clock();	
 	m_AnalysisTime = m_EndTime - m_StartTime;
 }
@@ -70,79 +197,596 @@ void SSAM::Analyze()
 		Analyze(m_TrjFileNames);
 
 	if (!m_TrjDataLists.empty())
+	{
 		Analyze(m_TrjDataLists);
+		ReleaseOwnedTrjDataLists();
+	}
 }
 
 void SSAM::Analyze(const std::list<std::string>& trjFileNames)
 {	
 	Initialize();
+	std::vector<std::string> fileNames;
 	for (std::list<std::string>::const_iterator it = trjFileNames.begin();
 		it != trjFileNames.end(); ++it)
 	{
-		if (it->empty())
-			continue;
+		if (!it->empty())
+			fileNames.push_back(*it);
+	}
 
-		m_TrjSrcName = *it;
-		if (m_TrjSrcName.substr(m_TrjSrcName.length() - 4, 4) != ".trj")
-			throw SSAMException("File \"" + m_TrjSrcName + "\" is not a .trj file."); 
+	if (m_NFileWorkers > 1 && fileNames.size() > 1)
+	{
+		AnalyzeTrjFilesParallel(fileNames);
+	} else
+	{
+		for (size_t i = 0; i < fileNames.size(); ++i)
+			AnalyzeTrjFile(fileNames[i]);
+	}
+	Terminate();
+}
 
-		m_TrjFile.open(m_TrjSrcName, std::ifstream::binary);
-		if(!m_TrjFile.good()) 
-			throw SSAMException("File \"" + m_TrjSrcName + "\" does not exist.");
+void SSAM::AnalyzeTrjFile(const std::string& trjFileName)
+{
+	OpenTrjFile(trjFileName);
 
-		if (m_IsWriteDat)
-			m_DatFile.open(m_TrjSrcName.substr(0, m_TrjSrcName.length() - 4)+"_dat.csv");
+	// the dat file lists the records in the order of the file, so it is written by a serial run
+	bool isSliced = (m_NTimeSlices > 1 && !m_IsWriteDat && m_MaxPET > 0);
+	bool isWindow = (m_WindowStart > -FLT_MAX || m_WindowEnd < FLT_MAX);
+	if (isSliced || isWindow)
+	{
+		TrjIndex index;
+		GetTrjIndex(index);
+		size_t firstStep = 0;
+		size_t endStep = index.GetSize();
+		if (isWindow)
+		{
+			firstStep = index.FindTimeStep(m_WindowStart - (m_MaxPET + m_MaxTTC));
+			endStep = index.FindTimeStepAfter(m_WindowEnd);
+		}
+		if (firstStep < endStep)
+			AnalyzeTrjFileSliced(index, firstStep, endStep, m_WindowStart, isSliced ? m_NTimeSlices : 1);
+		CloseRun();
+		CloseTrjFile();
+		return;
+	}
 
-		ReadTrjInputSize();
+	m_IsBuildIndex = false;
+	if (m_IsUseIndex && !m_TrjCache.IsOpen())
+	{
+		TrjIndex index;
+		m_IsBuildIndex = !index.Load(TrjIndex::GetIndexFileName(m_TrjSrcName), m_TrjReader.GetSize(), m_TrjReader.GetModifiedTime());
+		m_ReadIndex.Clear();
+	}
+
+	ResetTimeSteps();
+	long long fileBytes = m_TrjReader.GetSize() - GetTrjPosition();
+	double fileSeconds = 0;
+	if (m_PrefetchDepth > 0)
+		fileSeconds = AnalyzeTimeStepsPrefetched();
+	else
+		fileSeconds = AnalyzeTimeSteps();
+	CloseRun();
+
+	if (m_IsBuildIndex)
+	{
+		SaveTrjIndex(m_ReadIndex);
+		m_ReadIndex.Clear();
+		m_IsBuildIndex = false;
+	}
+	CloseTrjFile();
+
+	m_ReadBytes += fileBytes;
+	m_ReadSeconds += fileSeconds;
+	if (m_IsPrintProgress)
+		PrintReadThroughput(fileBytes, fileSeconds);
+}
+
+void SSAM::OpenTrjFile(const std::string& trjFileName)
+{
+	m_TrjSrcName = trjFileName;
+	if (m_TrjSrcName.substr(m_TrjSrcName.length() - 4, 4) != ".trj")
+		throw SSAMException("File \"" + m_TrjSrcName + "\" is not a .trj file."); 
+
+	m_TrjReader.Open(m_TrjSrcName);
+	m_CacheStep = 0;
+	if (m_IsUseCache)
+		m_TrjCache.Open(TrjCache::GetCacheFileName(m_TrjSrcName), m_TrjReader.GetSize(), m_TrjReader.GetModifiedTime());
+
+	if (m_IsWriteDat)
+		m_DatFile.open(m_TrjSrcName.substr(0, m_TrjSrcName.length() - 4)+"_dat.csv");
+
+	ReadTrjInputSize();
 
-		int recordType = ReadByte(m_TrjFile);
+	if (m_TrjCache.IsOpen())
+	{
+		// the cache keeps the header records, so the TRJ file itself is not read
+		const TrjCache::Header& header = m_TrjCache.GetHeader();
+		m_Format.m_Endian = header.m_Endian;
+		m_Format.m_Version = header.m_Version;
+		m_Format.m_ZOption = header.m_ZOption;
+		ValidateInputFormat();
+		m_pDimensions = std::make_shared<Dimensions>();
+		m_pDimensions->SetUnits(header.m_Units);
+		m_pDimensions->SetScale(header.m_Scale);
+		m_pDimensions->SetMinX(header.m_MinX);
+		m_pDimensions->SetMinY(header.m_MinY);
+		m_pDimensions->SetMaxX(header.m_MaxX);
+		m_pDimensions->SetMaxY(header.m_MaxY);
+	} else
+	{
+		int recordType = m_TrjReader.ReadByte();
 		if(recordType != TrjRecord::FORMAT)
 			throw SSAMException("Read error, expected FORMAT data not found.");
 		ReadInputFormat();
 		ValidateInputFormat();
 
-		recordType = ReadByte(m_TrjFile);
+		recordType = m_TrjReader.ReadByte();
 		if(recordType != TrjRecord::DIMENSIONS)
 			throw SSAMException("Read error, expected DIMENSIONS data not found.");
 		ReadDimensions(); 
-		m_pDimensions->Validate();
-		if (m_IsWriteDat)
-			m_pDimensions->Print(m_DatFile);
-		ApplyDimensions();
-		
-		m_ReadTimeStep = -1;
-		m_AnalysisTimeStep = -1;
-		m_IsFirstTimeStep = true;
-		m_StepDataList.clear();
-		m_EventList.clear();
-		m_pCurStep = NULL;
-		
-		char typeChar;
-		while (m_TrjFile.get(typeChar))
+	}
+	m_pDimensions->Validate();
+	if (m_IsWriteDat)
+		m_pDimensions->Print(m_DatFile);
+	ApplyDimensions();
+}
+
+void SSAM::ResetTimeSteps()
+{
+	m_ReadTimeStep = -1;
+	m_AnalysisTimeStep = -1;
+	m_IsFirstTimeStep = true;
+	m_StepDataList.clear();
+	m_VehicleTracks.Clear();
+	m_EventList.Clear();
+	m_pCurStep = NULL;
+}
+
+long long SSAM::GetTrjPosition() const
+{
+	if (!m_TrjCache.IsOpen())
+		return m_TrjReader.GetPosition();
+	if (m_CacheStep < m_TrjCache.GetNSteps())
+		return m_TrjCache.GetIndex().GetEntry(m_CacheStep).m_Offset;
+	return m_TrjReader.GetSize();
+}
+
+void SSAM::SeekTrjPosition(long long offset)
+{
+	if (m_TrjCache.IsOpen())
+		m_CacheStep = m_TrjCache.FindStep(offset);
+	else
+		m_TrjReader.Seek(offset);
+}
+
+void SSAM::GetTrjIndex(TrjIndex& index)
+{
+	if (m_TrjCache.IsOpen())
+	{
+		index = m_TrjCache.GetIndex();
+		return;
+	}
+	if (m_IsUseIndex && index.Load(TrjIndex::GetIndexFileName(m_TrjSrcName), m_TrjReader.GetSize(), m_TrjReader.GetModifiedTime()))
+		return;
+
+	long long dataOffset = m_TrjReader.GetPosition();
+	index.Build(m_TrjReader, m_Format.m_Version);
+	m_TrjReader.Seek(dataOffset);
+	if (m_IsUseIndex)
+		SaveTrjIndex(index);
+}
+
+void SSAM::SaveTrjIndex(const TrjIndex& index)
+{
+	std::string indexFileName = TrjIndex::GetIndexFileName(m_TrjSrcName);
+	// the index only speeds up later runs, so a read-only location does not stop the analysis
+	if (!index.Save(indexFileName, m_TrjReader.GetSize(), m_TrjReader.GetModifiedTime()) && m_IsPrintProgress)
+		std::cout << "Index file " << indexFileName << " could not be written." << std::endl;
+}
+
+void SSAM::BuildTrjIndex(const std::string& trjFileName)
+{
+	OpenTrjFile(trjFileName);
+	TrjIndex index;
+	index.Build(m_TrjReader, m_Format.m_Version);
+	bool isSaved = index.Save(TrjIndex::GetIndexFileName(m_TrjSrcName), m_TrjReader.GetSize(), m_TrjReader.GetModifiedTime());
+	CloseTrjFile();
+	if (!isSaved)
+		throw SSAMException("Index file \"" + TrjIndex::GetIndexFileName(m_TrjSrcName) + "\" could not be written.");
+}
+
+void SSAM::BuildTrjCache(const std::string& trjFileName)
+{
+	OpenTrjFile(trjFileName);
+	if (m_TrjCache.IsOpen())
+	{
+		// the cache is up to date
+		CloseTrjFile();
+		return;
+	}
+
+	TrjIndex index;
+	GetTrjIndex(index);
+	TrjCache::Header header;
+	memset(&header, 0, sizeof(header));
+	header.m_SourceSize = m_TrjReader.GetSize();
+	header.m_SourceTime = m_TrjReader.GetModifiedTime();
+	header.m_Endian = m_Format.m_Endian;
+	header.m_Version = m_Format.m_Version;
+	header.m_ZOption = m_Format.m_ZOption;
+	header.m_Units = m_pDimensions->GetUnits();
+	header.m_Scale = m_pDimensions->GetScale();
+	header.m_MinX = m_pDimensions->GetMinX();
+	header.m_MinY = m_pDimensions->GetMinY();
+	header.m_MaxX = m_pDimensions->GetMaxX();
+	header.m_MaxY = m_pDimensions->GetMaxY();
+
+	std::string cacheFileName = TrjCache::GetCacheFileName(m_TrjSrcName);
+	bool isSaved = TrjCache::Write(cacheFileName, m_TrjReader, index, header);
+	CloseTrjFile();
+	if (!isSaved)
+		throw SSAMException("Cache file \"" + cacheFileName + "\" could not be written.");
+}
+
+void SSAM::AnalyzeTrjFileSliced(const TrjIndex& index, size_t firstStep, size_t endStep, float reportTime, int nSlices)
+{
+	// split at the time steps that balance the number of bytes of the slices
+	std::vector<size_t> firstSteps;
+	long long dataOffset = index.GetEntry(firstStep).m_Offset;
+	long long dataSize = ((endStep < index.GetSize()) ? index.GetEntry(endStep).m_Offset : m_TrjReader.GetSize()) - dataOffset;
+	size_t k = firstStep;
+	for (int j = 0; j < nSlices; ++j)
+	{
+		long long sliceOffset = dataOffset + dataSize * j / nSlices;
+		while (k < endStep && index.GetEntry(k).m_Offset < sliceOffset)
+			++k;
+		if (k < endStep && (firstSteps.empty() || k > firstSteps.back()))
+			firstSteps.push_back(k);
+	}
+	nSlices = (int)firstSteps.size();
+	firstSteps.push_back(endStep);
+
+	std::vector<SP_SSAM> slices(nSlices);
+	std::vector<std::exception_ptr> errors(nSlices);
+	std::map<VehiclePair, float> noBlockedPairs;
+	std::set<VehiclePair> allPairs;
+	std::vector<std::thread> threads;
+	for (int j = 0; j < nSlices; ++j)
+	{
+		threads.push_back(std::thread([&, j]()
 		{
-			int recordType = typeChar;
-			if (recordType == TrjRecord::TIMESTEP)
+			try
 			{
-				float t = ReadFloat(m_TrjFile);
-				SetTimeStep(t);
-			} else if (recordType == TrjRecord::VEHICLE)
+				slices[j] = AnalyzeTimeSlice(index, firstSteps[j], firstSteps[j + 1], noBlockedPairs, allPairs);
+			} catch (...)
 			{
-				SP_Vehicle v = std::make_shared<Vehicle>();
-				v->SetTimeStep(m_pCurStep->GetTimestep());
-				ReadVehicle(v); 
-				if (m_IsWriteDat)
-					v->Print(m_DatFile, m_Format.m_Version);
-				if ( ValidateVehicle(v)) 
-					m_pCurStep->AddVehicle(v->GetVehicleID(), v);
-			} else
+				errors[j] = std::current_exception();
+			}
+		}));
+	}
+	for (size_t t = 0; t < threads.size(); ++t)
+		threads[t].join();
+	for (int j = 0; j < nSlices; ++j)
+	{
+		if (errors[j])
+			std::rethrow_exception(errors[j]);
+	}
+
+	// stitch the slices in time order; a pair with an event still open at the start
+	// of a slice creates no new event until that event is finished
+	std::vector<EventRecord> records;
+	std::map<VehiclePair, float> blockedPairs;
+	for (int j = 0; j < nSlices; ++j)
+	{
+		std::vector<EventRecord> sliceRecords;
+		std::set<VehiclePair> dirtyPairs;
+		const std::vector<EventRecord>& slicedRecords = slices[j]->m_EventRecords;
+		for (size_t i = 0; i < slicedRecords.size(); ++i)
+		{
+			const EventRecord& r = slicedRecords[i];
+			std::map<VehiclePair, float>::const_iterator itBlocked = blockedPairs.find(r.m_Pair);
+			if (itBlocked != blockedPairs.end() && r.m_FirstTimeStep <= itBlocked->second)
 			{
-				throw SSAMException("Invalid trajectory record type (outside of header): " + std::to_string(recordType));
+				// the event is a duplicate of the open event, and if it outlives that event
+				// it hides the events the serial analysis creates after it
+				if (r.m_LastTimeStep > itBlocked->second)
+					dirtyPairs.insert(r.m_Pair);
+				continue;
 			}
+			sliceRecords.push_back(r);
 		}
-		CloseRun();
-		m_TrjFile.close();
+
+		if (!dirtyPairs.empty())
+		{
+			std::map<VehiclePair, float> dirtyBlockedPairs;
+			std::vector<EventRecord> cleanRecords;
+			for (size_t i = 0; i < sliceRecords.size(); ++i)
+			{
+				if (dirtyPairs.find(sliceRecords[i].m_Pair) == dirtyPairs.end())
+					cleanRecords.push_back(sliceRecords[i]);
+			}
+			for (std::set<VehiclePair>::iterator it = dirtyPairs.begin(); it != dirtyPairs.end(); ++it)
+				dirtyBlockedPairs[*it] = blockedPairs[*it];
+
+			SP_SSAM pRerun = AnalyzeTimeSlice(index, firstSteps[j], firstSteps[j + 1], dirtyBlockedPairs, dirtyPairs);
+			sliceRecords.swap(cleanRecords);
+			sliceRecords.insert(sliceRecords.end(), pRerun->m_EventRecords.begin(), pRerun->m_EventRecords.end());
+			slices[j]->m_ReadBytes += pRerun->m_ReadBytes;
+			slices[j]->m_ReadSeconds += pRerun->m_ReadSeconds;
+			slices[j]->m_VehiclePool.AddCounts(pRerun->m_VehiclePool);
+			slices[j]->m_ProjectionCache.AddCounts(pRerun->m_ProjectionCache);
+		}
+
+		float nextSliceTime = (firstSteps[j + 1] < index.GetSize()) ? index.GetEntry(firstSteps[j + 1]).m_TimeStep : FLT_MAX;
+		std::map<VehiclePair, float>::iterator itBlocked = blockedPairs.begin();
+		while (itBlocked != blockedPairs.end())
+		{
+			if (itBlocked->second < nextSliceTime)
+				blockedPairs.erase(itBlocked++);
+			else
+				++itBlocked;
+		}
+		for (size_t i = 0; i < sliceRecords.size(); ++i)
+		{
+			if (sliceRecords[i].m_LastTimeStep >= nextSliceTime)
+				blockedPairs[sliceRecords[i].m_Pair] = sliceRecords[i].m_LastTimeStep;
+		}
+		records.insert(records.end(), sliceRecords.begin(), sliceRecords.end());
 	}
-	Terminate();
+
+	// the serial analysis finishes events in time order, and in pair order within a time step
+	std::sort(records.begin(), records.end(), [](const EventRecord& a, const EventRecord& b)
+	{
+		if (a.m_LastTimeStep != b.m_LastTimeStep)
+			return a.m_LastTimeStep < b.m_LastTimeStep;
+		return a.m_Pair < b.m_Pair;
+	});
+	for (size_t i = 0; i < records.size(); ++i)
+	{
+		if (records[i].m_pConflict == NULL || records[i].m_FirstTimeStep < reportTime)
+			continue;
+		EmitConflict(records[i].m_pConflict, m_TrjSrcName);
+	}
+
+	long long fileBytes = 0;
+	double fileSeconds = 0;
+	for (int j = 0; j < nSlices; ++j)
+	{
+		fileBytes += slices[j]->m_ReadBytes;
+		fileSeconds += slices[j]->m_ReadSeconds;
+		m_VehiclePool.AddCounts(slices[j]->m_VehiclePool);
+		m_ProjectionCache.AddCounts(slices[j]->m_ProjectionCache);
+	}
+	m_ReadBytes += fileBytes;
+	m_ReadSeconds += fileSeconds;
+	if (m_IsPrintProgress)
+		PrintReadThroughput(fileBytes, fileSeconds);
+}
+
+SP_SSAM SSAM::AnalyzeTimeSlice(const TrjIndex& index, size_t firstStep, size_t endStep,
+	const std::map<VehiclePair, float>& blockedPairs, const std::set<VehiclePair>& pairFilter) const
+{
+	SP_SSAM pSlice = CreateFileWorker();
+	pSlice->m_NTimeSlices = 1;
+	pSlice->m_IsWriteDat = false;
+	pSlice->m_IsRecordEvents = true;
+	// starting the analysis lag at the previous time step replays the serial analysis exactly
+	pSlice->m_SlicePrevTimeStep = (firstStep > 0) ? index.GetEntry(firstStep - 1).m_TimeStep : -FLT_MAX;
+	pSlice->m_SliceEndTime = (endStep < index.GetSize()) ? index.GetEntry(endStep).m_TimeStep : FLT_MAX;
+	pSlice->m_BlockedPairs = blockedPairs;
+	pSlice->m_PairFilter = pairFilter;
+	for (std::set<VehiclePair>::const_iterator it = pairFilter.begin(); it != pairFilter.end(); ++it)
+	{
+		pSlice->m_VehicleFilter.insert(it->first);
+		pSlice->m_VehicleFilter.insert(it->second);
+	}
+	pSlice->Initialize();
+	pSlice->AnalyzeTrjSlice(m_TrjSrcName, index.GetEntry(firstStep).m_Offset);
+	return pSlice;
+}
+
+void SSAM::AnalyzeTrjSlice(const std::string& trjFileName, long long offset)
+{
+	OpenTrjFile(trjFileName);
+	SeekTrjPosition(offset);
+	ResetTimeSteps();
+
+	double sliceSeconds = 0;
+	if (m_PrefetchDepth > 0)
+		sliceSeconds = AnalyzeTimeStepsPrefetched();
+	else
+		sliceSeconds = AnalyzeTimeSteps();
+	CloseRun();
+
+	// events still open at the end of file are never finished
+	m_EventList.Order();
+	for (size_t k = 0; k < m_EventList.GetNOrdered(); ++k)
+		RecordEvent(m_EventList.GetPair(k), m_EventList.GetEvent(k), FLT_MAX, NULL);
+	m_EventList.Clear();
+
+	m_ReadBytes += GetTrjPosition() - offset;
+	m_ReadSeconds += sliceSeconds;
+	CloseTrjFile();
+}
+
+bool SSAM::IsEventAllowed(const VehiclePair& vehPair) const
+{
+	if (m_AnalysisTimeStep >= m_SliceEndTime)
+		return false;
+	if (!m_PairFilter.empty() && m_PairFilter.find(vehPair) == m_PairFilter.end())
+		return false;
+	if (!m_BlockedPairs.empty())
+	{
+		std::map<VehiclePair, float>::const_iterator it = m_BlockedPairs.find(vehPair);
+		if (it != m_BlockedPairs.end() && m_AnalysisTimeStep <= it->second)
+			return false;
+	}
+	return true;
+}
+
+void SSAM::RecordEvent(const VehiclePair& vehPair, SP_Event e, float lastTimeStep, SP_Conflict c)
+{
+	EventRecord r;
+	r.m_Pair = vehPair;
+	r.m_FirstTimeStep = e->GetFirstTimeStep();
+	r.m_LastTimeStep = lastTimeStep;
+	r.m_pConflict = c;
+	m_EventRecords.push_back(r);
+}
+
+void SSAM::AnalyzeTrjFilesParallel(const std::vector<std::string>& trjFileNames)
+{
+	int nFiles = (int)trjFileNames.size();
+	std::vector<SP_SSAM> workers(nFiles);
+	std::vector<std::exception_ptr> errors(nFiles);
+	std::atomic<int> nextFile(0);
+
+	// each file is analyzed by its own SSAM object, so no analysis state is shared
+	std::vector<std::thread> threads;
+	int nThreads = std::min(m_NFileWorkers, nFiles);
+	for (int t = 0; t < nThreads; ++t)
+	{
+		threads.push_back(std::thread([&]()
+		{
+			int i = 0;
+			while ((i = nextFile++) < nFiles)
+			{
+				try
+				{
+					SP_SSAM pWorker = CreateFileWorker();
+					pWorker->Initialize();
+					pWorker->AnalyzeTrjFile(trjFileNames[i]);
+					workers[i] = pWorker;
+				} catch (...)
+				{
+					errors[i] = std::current_exception();
+				}
+			}
+		}));
+	}
+	for (size_t t = 0; t < threads.size(); ++t)
+		threads[t].join();
+
+	// merge in the order of the file list, as the serial analysis does
+	for (int i = 0; i < nFiles; ++i)
+	{
+		if (errors[i])
+			std::rethrow_exception(errors[i]);
+		MergeFileWorker(*workers[i]);
+	}
+}
+
+SP_SSAM SSAM::CreateFileWorker() const
+{
+	SP_SSAM pWorker = std::make_shared<SSAM>();
+	pWorker->m_MaxTTC = m_MaxTTC;
+	pWorker->m_MaxPET = m_MaxPET;
+	pWorker->m_RearEndAngleThreshold = m_RearEndAngleThreshold;
+	pWorker->m_CrossingAngleThreshold = m_CrossingAngleThreshold;
+	pWorker->m_IsCalcPUEA = m_IsCalcPUEA;
+	pWorker->m_TTCEngine = m_TTCEngine;
+	pWorker->m_Broadphase = m_Broadphase;
+	pWorker->m_IsWriteDat = m_IsWriteDat;
+	pWorker->m_NThreads = m_NThreads;
+	pWorker->m_PrefetchDepth = m_PrefetchDepth;
+	pWorker->m_NTimeSlices = m_NTimeSlices;
+	pWorker->m_WindowStart = m_WindowStart;
+	pWorker->m_WindowEnd = m_WindowEnd;
+	pWorker->m_IsUseIndex = m_IsUseIndex;
+	pWorker->m_IsUseCache = m_IsUseCache;
+	pWorker->m_NSteps = m_NSteps;
+	pWorker->m_IsPrintProgress = m_IsPrintProgress;
+	return pWorker;
+}
+
+void SSAM::MergeFileWorker(const SSAM& worker)
+{
+	// a worker analyzes one file, so its conflict list is in the order of the file
+	for (std::list<SP_Conflict>::const_iterator it = worker.m_ConflictList.begin();
+		it != worker.m_ConflictList.end(); ++it)
+		EmitConflict(*it, (*it)->trjFile);
+
+	m_Boundary[0] = std::min(m_Boundary[0], worker.m_Boundary[0]);
+	m_Boundary[1] = std::min(m_Boundary[1], worker.m_Boundary[1]);
+	m_Boundary[2] = std::max(m_Boundary[2], worker.m_Boundary[2]);
+	m_Boundary[3] = std::max(m_Boundary[3], worker.m_Boundary[3]);
+	m_TrjSrcName = worker.m_TrjSrcName;
+	m_Format = worker.m_Format;
+	m_pDimensions = worker.m_pDimensions;
+	m_Units = worker.m_Units;
+	m_ZoneSize = worker.m_ZoneSize;
+	m_ReadBytes += worker.m_ReadBytes;
+	m_ReadSeconds += worker.m_ReadSeconds;
+	m_NEnteredVehicles += worker.m_NEnteredVehicles;
+	m_NLeftVehicles += worker.m_NLeftVehicles;
+	m_VehiclePool.AddCounts(worker.m_VehiclePool);
+	m_ProjectionCache.AddCounts(worker.m_ProjectionCache);
+}
+
+double SSAM::AnalyzeTimeSteps()
+{
+	double readSeconds = 0;
+	SP_TimeStepData pStep;
+	while (true)
+	{
+		std::chrono::high_resolution_clock::time_point readStart = std::chrono::high_resolution_clock::now();
+		bool isRead = ReadTimeStep(pStep);
+		readSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - readStart).count();
+		if (!isRead)
+			break;
+		AnalyzeTimeStep(pStep);
+		if (IsSliceDrained())
+			break;
+	}
+	return readSeconds;
+}
+
+double SSAM::AnalyzeTimeStepsPrefetched()
+{
+	BoundedQueue<SP_TimeStepData> stepQueue(m_PrefetchDepth);
+	double readSeconds = 0;
+	std::exception_ptr readError;
+
+	// the reader thread only touches the TRJ reader and the dat file,
+	// the analysis state stays on this thread
+	std::thread reader([&]()
+	{
+		try
+		{
+			SP_TimeStepData pStep;
+			while (true)
+			{
+				std::chrono::high_resolution_clock::time_point readStart = std::chrono::high_resolution_clock::now();
+				bool isRead = ReadTimeStep(pStep);
+				readSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - readStart).count();
+				if (!isRead || !stepQueue.Push(pStep))
+					break;
+			}
+		} catch (...)
+		{
+			readError = std::current_exception();
+		}
+		stepQueue.Close();
+	});
+
+	try
+	{
+		SP_TimeStepData pStep;
+		while (!IsSliceDrained() && stepQueue.Pop(pStep))
+			AnalyzeTimeStep(pStep);
+	} catch (...)
+	{
+		stepQueue.Close();
+		reader.join();
+		throw;
+	}
+	// a drained time slice stops the reader before the end of file
+	stepQueue.Close();
+	reader.join();
+
+	if (readError)
+		std::rethrow_exception(readError);
+	return readSeconds;
 }
 
 void SSAM::Analyze(const std::list<TrjDataList>& trjDataLists)
@@ -151,26 +795,29 @@ void SSAM::Analyze(const std::list<TrjDataList>& trjDataLists)
 	for (std::list<TrjDataList>::const_iterator it = trjDataLists.begin();
 		it != trjDataLists.end(); ++it)
 	{
-		if (it->second->empty())
+		std::list<TrjRecord>* pTrjDataList = it->second;
+		if (pTrjDataList->empty())
 			continue;
 
+		// records of a borrowed list are read in place, records of an owned list are consumed
+		bool isOwned = IsOwnedTrjDataList(pTrjDataList);
 		SetTrjSrcName(it->first);
-		m_TrjDataList = *(it->second);
+		m_pTrjDataList = pTrjDataList;
 		ReadTrjInputSize();
 
-		std::list<TrjRecord>::iterator itRec = m_TrjDataList.begin();
+		std::list<TrjRecord>::iterator itRec = pTrjDataList->begin();
 		if(itRec->GetRecordType() != TrjRecord::FORMAT)
 			throw SSAMException("Expected FORMAT data not found.");
 		SetFormat(itRec->GetFormat());
 		
 		itRec++;
-		if(itRec == m_TrjDataList.end() 
+		if(itRec == pTrjDataList->end() 
 			|| itRec->GetRecordType() != TrjRecord::DIMENSIONS)
 			throw SSAMException("Expected DIMENSIONS data not found.");
 		SetDimensions(itRec->GetDimensions());
 		
 		itRec++;
-		while (itRec != m_TrjDataList.end()) 
+		while (itRec != pTrjDataList->end()) 
 		{
 			int recordType = itRec->GetRecordType();
 			if (recordType == TrjRecord::TIMESTEP)
@@ -178,18 +825,50 @@ void SSAM::Analyze(const std::list<TrjDataList>& trjDataLists)
 				SetTimeStep(itRec->GetTimestep());
 			} else if (recordType == TrjRecord::VEHICLE)
 			{
-				SetVehicle(itRec->GetVehicle());
+				if (isOwned)
+					AdoptVehicle(itRec->GetVehicle());
+				else
+					SetVehicle(itRec->GetVehicle());
 			} else
 			{
 				throw SSAMException("Invalid trajectory record type (outside of header): " + std::to_string(recordType));
 			}
-			itRec++;
+
+			if (isOwned)
+				itRec = pTrjDataList->erase(itRec);
+			else
+				itRec++;
 		}
+		m_pTrjDataList = NULL;
 		CloseRun();
 	}
 	Terminate();
 }
 
+bool SSAM::IsOwnedTrjDataList(const std::list<TrjRecord>* pTrjDataList) const
+{
+	for (std::list<std::list<TrjRecord> >::const_iterator it = m_OwnedTrjDataLists.begin();
+		it != m_OwnedTrjDataLists.end(); ++it)
+	{
+		if (&(*it) == pTrjDataList)
+			return true;
+	}
+	return false;
+}
+
+void SSAM::ReleaseOwnedTrjDataLists()
+{
+	std::list<TrjDataList>::iterator it = m_TrjDataLists.begin();
+	while (it != m_TrjDataLists.end())
+	{
+		if (IsOwnedTrjDataList(it->second))
+			m_TrjDataLists.erase(it++);
+		else
+			++it;
+	}
+	m_OwnedTrjDataLists.clear();
+}
+
 void SSAM::SetTrjSrcName(const std::string& s) 
 { 
 	m_TrjSrcName = s;
@@ -221,7 +900,8 @@ void SSAM::SetTimeStep(float t)
 		m_ReadTimeStep = -1;
 		m_AnalysisTimeStep = -1;
 		m_StepDataList.clear();
-		m_EventList.clear();
+		m_VehicleTracks.Clear();
+		m_EventList.Clear();
 		m_pCurStep = NULL;
 	}
 
@@ -230,7 +910,7 @@ void SSAM::SetTimeStep(float t)
 		AnalyzeOneStep();
 	}
 				
-	m_pCurStep = std::make_shared<TimeStepData>();
+	m_pCurStep = std::make_shared<TimeStepData>(m_VehiclePool.Acquire());
 	m_pCurStep->SetTimestep(t); // 
 	if (m_IsPrintProgress && fmod(t, 100) == 0)
 	{
@@ -248,13 +928,108 @@ void SSAM::SetTimeStep(float t)
 
 void SSAM::SetVehicle(SP_Vehicle pVeh)
 {
-	SP_Vehicle v = std::make_shared<Vehicle>(*pVeh);
+	CopyVehicle(*pVeh);
+}
+
+void SSAM::SetVehicles(const Vehicle* vehicles, size_t n)
+{
+	for (size_t i = 0; i < n; ++i)
+		CopyVehicle(vehicles[i]);
+}
+
+void SSAM::CopyVehicle(const Vehicle& veh)
+{
+	Vehicle& v = m_pCurStep->NewVehicle();
+	v = veh;
+	v.Unlink();
 	if (m_IsWriteDat)
-		v->Print(m_DatFile, m_Format.m_Version);
+		v.Print(m_DatFile, m_Format.m_Version);
 	if ( ValidateVehicle(v)) 
+		m_pCurStep->AddVehicle(v);
+	else
+		m_pCurStep->FreeVehicle();
+}
+
+void SSAM::SetTimeStepVehicles(float t, const VehicleState* vehicles, size_t n)
+{
+	SetTimeStep(t);
+
+	bool hasZ = (m_Format.m_Version > ORIG_FORMAT_VERSION);
+	float scale = m_pDimensions->GetScale();
+	float minX = (float)m_pDimensions->GetMinX();
+	float maxX = (float)m_pDimensions->GetMaxX();
+	float minY = (float)m_pDimensions->GetMinY();
+	float maxY = (float)m_pDimensions->GetMaxY();
+
+	// the vehicle centers are checked first, so that vehicles outside of the area are never built
+	std::vector<char> isValid(n);
+	size_t nValid = 0;
+	for (size_t i = 0; i < n; ++i)
+	{
+		const VehicleState& s = vehicles[i];
+		float centerX = s.m_RearX + (s.m_FrontX - s.m_RearX)/2.0;
+		float centerY = s.m_RearY + (s.m_FrontY - s.m_RearY)/2.0;
+		isValid[i] = (centerX >= minX && centerX <= maxX && centerY >= minY && centerY <= maxY);
+		nValid += isValid[i];
+	}
+
+	m_pCurStep->Reserve(m_IsWriteDat ? n : nValid);
+	for (size_t i = 0; i < n; ++i)
+	{
+		if (!isValid[i] && !m_IsWriteDat)
+			continue;
+
+		const VehicleState& s = vehicles[i];
+		Vehicle& v = m_pCurStep->NewVehicle();
+		v.SetTimeStep(t);
+		v.SetVehicleID(s.m_VehicleID);
+		v.SetLinkID(s.m_LinkID);
+		v.SetLaneID((char)s.m_LaneID);
+		v.setScale(scale);
+		v.SetLength(s.m_Length);
+		v.SetWidth(s.m_Width);
+		v.SetSpeed(s.m_Speed);
+		v.SetAcceleration(s.m_Acceleration);
+		v.SetPosition(s.m_FrontX, s.m_FrontY, s.m_RearX, s.m_RearY);
+		if (hasZ)
+		{
+			v.SetFrontZ(s.m_FrontZ);
+			v.SetRearZ(s.m_RearZ);
+		}
+		if (m_IsWriteDat)
+			v.Print(m_DatFile, m_Format.m_Version);
+		if (isValid[i])
+			m_pCurStep->AddVehicle(v);
+		else
+			m_pCurStep->FreeVehicle();
+	}
+
+	AnalyzeOneStep();
+	m_pCurStep = NULL;
+}
+
+void SSAM::AdoptVehicle(SP_Vehicle v)
+{
+	v->Unlink();
+	if (m_IsWriteDat)
+		v->Print(m_DatFile, m_Format.m_Version);
+	if ( ValidateVehicle(*v)) 
 		m_pCurStep->AddVehicle(v->GetVehicleID(), v);
 }
 
+void SSAM::AnalyzeTimeStep(SP_TimeStepData pStep)
+{
+	float t = pStep->GetTimestep();
+	if (m_IsPrintProgress && fmod(t, 100) == 0)
+	{
+		std::cout << "Time: " << t <<std::endl;
+	}
+
+	m_pCurStep = pStep;
+	AnalyzeOneStep();
+	m_pCurStep = NULL;
+}
+
 void SSAM::CloseRun()
 {
 	// check whether to process the last set of steps and proceed if enough data
@@ -266,6 +1041,8 @@ void SSAM::CloseRun()
 	if (m_IsWriteDat)
 		m_DatFile.close();
 
+	// the arenas of the time steps still in the window are released with the time steps
+	m_VehiclePool.Clear();
 	m_IsFirstTimeStep = true;
 }
 
@@ -276,6 +1053,10 @@ void SSAM::ApplyDimensions()
 		m_ZoneSize = (int)(50.0/m_pDimensions->GetScale());
 	else if(m_Units == Dimensions::METRIC_UNITS)
 		m_ZoneSize = (int)(15.0/m_pDimensions->GetScale());
+	// the zone size is tuned at the first time step analyzed
+	m_BaseZoneSize = (int)m_ZoneSize;
+	m_NStepsToTuneZones = 0;
+	m_NZoneTunings = 0;
 		
 	if (m_pZoneGrid == NULL)
 	{
@@ -292,6 +1073,16 @@ void SSAM::ApplyDimensions()
 			m_pDimensions->GetMaxY(),
 			m_ZoneSize);
 	}
+	if (m_Broadphase == SWEEP_PRUNE_BROADPHASE)
+	{
+		if (m_pSweepPrune == NULL)
+			m_pSweepPrune = std::make_shared<SweepPrune>();
+		m_pSweepPrune->ResetArea(m_pDimensions->GetMinX(), 
+			m_pDimensions->GetMinY(), 
+			m_pDimensions->GetMaxX(),
+			m_pDimensions->GetMaxY());
+		m_SweepAxis = -1;
+	}
 
 	if (m_pDimensions->GetMinX() < m_Boundary[0])
 		m_Boundary[0] = m_pDimensions->GetMinX();
@@ -348,34 +1139,33 @@ void SSAM::AnalyzeOneStep()
 	m_ReadTimeStep = m_pCurStep->GetTimestep();
 
 	//	Link vehicles from this step to previous step	
+	m_pCurStep->BuildIndex();
+	size_t nVehicles = m_pCurStep->GetNVehicles();
+	size_t nEntered = nVehicles;
+	size_t nLeft = 0;
 	if(!m_StepDataList.empty())
 	{
-		std::map<int, SP_Vehicle> *prevStep = m_StepDataList.back()->GetVehicleMap();
-		if(prevStep == NULL)
-			throw SSAMException("Processing failed to link vehicle from previous timestep to current timestep.");
-				
-		std::map<int, SP_Vehicle>::iterator iVeh = prevStep->begin();
-		for(; iVeh != prevStep->end(); ++iVeh)
-		{
-			SP_Vehicle vPrev = iVeh->second;
-			if(vPrev == NULL)
-				throw SSAMException("Step analysis failed, linking invalid vehicle from previous timestep.");
-					
-			int preID = vPrev->GetVehicleID();
-			SP_Vehicle vNext = NULL;
-			std::map<int, SP_Vehicle> *curStepVeh = m_pCurStep->GetVehicleMap();
-			if (curStepVeh->find(preID) != curStepVeh->end())
-				vNext = curStepVeh->at(preID); 
-
-			if(vNext != NULL)
-				vPrev->SetNext(vNext);
-		}
+		TimeStepData& prevStep = *m_StepDataList.back();
+		size_t nLinked = prevStep.LinkNext(*m_pCurStep);
+		nEntered = nVehicles - nLinked;
+		nLeft = prevStep.GetNVehicles() - nLinked;
+	}
+	else if (m_SlicePrevTimeStep != -FLT_MAX)
+	{
+		m_AnalysisTimeStep = m_SlicePrevTimeStep;
 	}
 	else
 	{
 		m_AnalysisTimeStep = m_ReadTimeStep - 1;
 	}
+	m_VehicleTracks.AddTimeStep(m_StepDataList.empty() ? NULL : &m_StepDataList.back()->GetVehicles(), m_pCurStep->GetVehicles());
 	m_StepDataList.push_back(m_pCurStep);
+	m_NEnteredVehicles += nEntered;
+	m_NLeftVehicles += nLeft;
+	if (m_IsPrintProgress && fmod(m_ReadTimeStep, 100) == 0)
+	{
+		std::cout << "Vehicles: " << nVehicles << " (" << nEntered << " entered, " << nLeft << " left)" << std::endl;
+	}
 
 	// check whether to process the set of steps and proceed if enough data
 	// and then remove the first step in the current set
@@ -385,94 +1175,227 @@ void SSAM::AnalyzeOneStep()
 		DetectConflicts(m_pZoneGrid, m_EventList);
 		//	Discard the first timestep (if any)
 		if(!m_StepDataList.empty())
+		{
+			m_VehicleTracks.RemoveTimeStep(m_StepDataList.front()->GetVehicles());
 			m_StepDataList.pop_front();
+		}
 	}
 }
 
-void SSAM::DetectConflicts(SP_ZoneGrid pZoneGrid, std::map<VehiclePair, SP_Event>& eventList)
+void SSAM::DetectConflicts(SP_ZoneGrid pZoneGrid, EventTable& eventList)
 {
-	pZoneGrid->ClearGrid();
-		
 	SP_TimeStepData step = m_StepDataList.front();
-	std::map<int, SP_Vehicle>* stepVehMap = step->GetVehicleMap();
-	std::vector<SP_Vehicle>* stepVehVec = step->GetVehicleVec();
+	int nVehicles = (int)step->GetNVehicles();
+	m_ProjectionCache.BeginTimeStep(nVehicles, m_VehicleTracks, Event::GetNTTCs(m_MaxTTC));
+	m_StepWindow.resize(m_StepDataList.size());
+	for (size_t i = 0; i < m_StepDataList.size(); ++i)
+		m_StepWindow[i] = &m_StepDataList[i]->GetVehicles();
 		
+	m_GridVehicles.clear();
+	for(int iv = 0; iv < nVehicles; ++iv)
+	{
+		if (m_VehicleFilter.empty() || m_VehicleFilter.find(step->GetVehicleID(iv)) != m_VehicleFilter.end())
+			m_GridVehicles.push_back(iv);
+	}
+	int nGridVehicles = (int)m_GridVehicles.size();
+
 #ifdef _OPENMP_LOCAL
 	omp_set_num_threads(m_NThreads);
 
-	#pragma omp parallel for shared(pZoneGrid, eventList)
+	#pragma omp parallel for
 #endif
-	for(int iv = 0; iv < stepVehVec->size(); ++iv)
+	for(int k = 0; k < nGridVehicles; ++k)
 	{
-		SP_Vehicle v = stepVehVec->at(iv);
-		SP_Vehicle vProj = v->CalcProjection(m_MaxTTC,m_MaxPET);
+		int iv = m_GridVehicles[k];
+		m_ProjectionCache.ProjectVehicle(iv, *step->GetVehicle(iv), m_MaxTTC, m_MaxPET);
+	}
 
-		std::map<int, SP_Vehicle> newCrashVehicles;
-		pZoneGrid->AddVehicle(vProj, newCrashVehicles);
-		if(!newCrashVehicles.empty())
+	// the footprint indexes are the vehicle indexes of the time step
+	if (m_Broadphase == SWEEP_PRUNE_BROADPHASE)
+	{
+		m_pSweepPrune->Build(m_ProjectionCache.GetShapes(), m_GridVehicles);
+		if (m_IsPrintProgress && m_pSweepPrune->GetAxis() != m_SweepAxis)
+			std::cout << "Sweep axis: " << (m_pSweepPrune->GetAxis() == SweepPrune::X_AXIS ? "x" : "y") << std::endl;
+		m_SweepAxis = m_pSweepPrune->GetAxis();
+		m_pSweepPrune->FindCrashes(m_ProjectionCache.GetShapes(), m_GridCrashes);
+		// the vehicles keep their order in the next time step
+		m_pSweepPrune->CarryOrder(step->GetVehicles());
+	}
+	else
+	{
+		// the zone size follows the size and the crowding of the projected footprints
+		if (--m_NStepsToTuneZones <= 0 && m_GridVehicles.size() > 1)
 		{
-			std::map<int, SP_Vehicle>::iterator it = newCrashVehicles.begin();
-			for (;it != newCrashVehicles.end(); ++it)
-			{
-				SP_Vehicle vCrash = it->second;
-				SP_Vehicle vActual = NULL;
-				if (stepVehMap->find(vCrash->GetVehicleID()) != stepVehMap->end())
-					vActual = stepVehMap->at(vCrash->GetVehicleID()); 
-				else
-					continue;
-					
-				int idLo = min(vActual->GetVehicleID(), v->GetVehicleID());
-				int idHi = max(vActual->GetVehicleID(), v->GetVehicleID());
-				VehiclePair  vehPair(idLo, idHi);
-				SP_Event pEvent = NULL;
-#ifdef _OPENMP_LOCAL
-				#pragma omp critical (ADDEVENTDATA)
-#endif
-				if (eventList.find(vehPair)  != eventList.end())
-				{
-					pEvent = eventList[vehPair]; 
-					pEvent->AddVehicleData(vActual, v);
-				} else
-				{
-					m_InitEventParams.m_V1 = vActual;
-					m_InitEventParams.m_V2 = v;
-					pEvent = std::make_shared<Event>(m_InitEventParams);
-					eventList[vehPair] = pEvent;
-				}
-			}
+			int zoneSize = pZoneGrid->TuneZoneSize(m_ProjectionCache.GetShapes(), m_GridVehicles, m_BaseZoneSize);
+			if (m_IsPrintProgress && (m_NZoneTunings == 0 || zoneSize != (int)m_ZoneSize))
+				std::cout << "Zone size: " << zoneSize << " (base " << m_BaseZoneSize << ", " << pZoneGrid->GetNZones() << " zones)" << std::endl;
+			m_ZoneSize = zoneSize;
+			m_NStepsToTuneZones = ZoneGrid::TUNE_INTERVAL;
+			++m_NZoneTunings;
+		}
+		pZoneGrid->Build(m_ProjectionCache.GetShapes(), m_GridVehicles);
+		pZoneGrid->FindCrashes(m_ProjectionCache.GetShapes(), m_GridCrashes);
+	}
+	for (size_t i = 0; i < m_GridCrashes.size(); ++i)
+	{
+		const SP_Vehicle& vActual = step->GetVehicle(m_GridCrashes[i].first);
+		const SP_Vehicle& v = step->GetVehicle(m_GridCrashes[i].second);
+				
+		int idLo = min(vActual->GetVehicleID(), v->GetVehicleID());
+		int idHi = max(vActual->GetVehicleID(), v->GetVehicleID());
+		Event* e = eventList.Find(idLo, idHi);
+		if (e != NULL)
+		{
+			e->AddVehicleData(*vActual, *v);
+		} else if (IsEventAllowed(VehiclePair(idLo, idHi)))
+		{
+			m_InitEventParams.m_pV1 = vActual.get();
+			m_InitEventParams.m_pV2 = v.get();
+			eventList.Add(idLo, idHi, m_InitEventParams);
 		}
 	}
 
-	if (!eventList.empty())
+	if (!eventList.IsEmpty())
 	{	
 		AnalyzEvents(m_TrjSrcName, eventList);
 	}
 }
 
-void SSAM::AnalyzEvents(const std::string& trjSrcName, std::map<VehiclePair, SP_Event>& eventList)
+void SSAM::AnalyzEvents(const std::string& trjSrcName, EventTable& eventList)
 {
-	std::map<VehiclePair, SP_Event>::iterator it = eventList.begin();
-	while (it != eventList.end())
+	eventList.Order();
+	int nEvents = (int)eventList.GetNOrdered();
+	int nThreads = 1;
+#ifdef _OPENMP_LOCAL
+	if (nEvents >= MIN_PARALLEL_EVENTS)
+		nThreads = omp_get_max_threads();
+#endif
+	if ((int)m_EventBuffers.size() < nThreads)
+		m_EventBuffers.resize(nThreads);
+	while ((int)m_EventCaches.size() < nThreads - 1)
+		m_EventCaches.push_back(std::make_shared<ProjectionCache>());
+	// the team may have fewer threads than asked for, whose buffers are left empty
+	for (int t = 0; t < nThreads; ++t)
+	{
+		m_EventBuffers[t].m_Finished.clear();
+		m_EventBuffers[t].m_pError = NULL;
+	}
+
+	// the events are independent of each other, and are analyzed in any order, each thread keeping the events it finishes
+#ifdef _OPENMP_LOCAL
+	#pragma omp parallel num_threads(nThreads)
+#endif
 	{
-		SP_Event e = it->second;
-		if(e->AnalyzeData(m_AnalysisTimeStep) == false)
+#ifdef _OPENMP_LOCAL
+		int t = omp_get_thread_num();
+#else
+		int t = 0;
+#endif
+		EventBuffer& buffer = m_EventBuffers[t];
+		// the first thread finds the projections made for the broadphase, the other threads make their own
+		ProjectionCache* pCache = &m_ProjectionCache;
+		if (t > 0)
 		{
-			if(e->IsConflict())
-			{
-				CreateConflict(e,trjSrcName);
-			}
-			eventList.erase(it++);	
+			pCache = m_EventCaches[t - 1].get();
+			pCache->BeginTimeStep(0, m_VehicleTracks, Event::GetNTTCs(m_MaxTTC));
 		}
-		else
+#ifdef _OPENMP_LOCAL
+		#pragma omp for schedule(dynamic, 8)
+#endif
+		for (int k = 0; k < nEvents; ++k)
 		{
-			++it;
+			if (buffer.m_pError != NULL)
+				continue;
+			try
+			{
+				const SP_Event& e = eventList.GetEvent(k);
+				if(e->AnalyzeData(m_AnalysisTimeStep, m_StepWindow, *pCache) == false)
+				{
+					FinishedEvent finished;
+					finished.m_Position = k;
+					if(e->IsConflict())
+						finished.m_pConflict = std::make_shared<Conflict>(e, trjSrcName);
+					buffer.m_Finished.push_back(finished);
+				}
+			} catch (...)
+			{
+				buffer.m_pError = std::current_exception();
+				buffer.m_ErrorPosition = k;
+			}
 		}
 	}
+
+	// the finished events are merged in the order of the vehicle pairs, in which the conflicts are created
+	m_FinishedEvents.clear();
+	int iError = -1;
+	for (int t = 0; t < nThreads; ++t)
+	{
+		const EventBuffer& buffer = m_EventBuffers[t];
+		m_FinishedEvents.insert(m_FinishedEvents.end(), buffer.m_Finished.begin(), buffer.m_Finished.end());
+		if (buffer.m_pError != NULL && (iError < 0 || buffer.m_ErrorPosition < m_EventBuffers[iError].m_ErrorPosition))
+			iError = t;
+	}
+	for (int t = 1; t < nThreads; ++t)
+	{
+		m_ProjectionCache.AddCounts(*m_EventCaches[t - 1]);
+		m_EventCaches[t - 1]->ClearCounts();
+	}
+	if (iError >= 0)
+		std::rethrow_exception(m_EventBuffers[iError].m_pError);
+	std::sort(m_FinishedEvents.begin(), m_FinishedEvents.end(), 
+		[](const FinishedEvent& a, const FinishedEvent& b) { return a.m_Position < b.m_Position; });
+
+	for (size_t i = 0; i < m_FinishedEvents.size(); ++i)
+	{
+		const FinishedEvent& finished = m_FinishedEvents[i];
+		// the conflicts of a time slice are emitted when the slices are merged
+		if (m_IsRecordEvents)
+			RecordEvent(eventList.GetPair(finished.m_Position), eventList.GetEvent(finished.m_Position), m_AnalysisTimeStep, finished.m_pConflict);
+		else if (finished.m_pConflict != NULL)
+			EmitConflict(finished.m_pConflict, trjSrcName);
+		eventList.Remove(finished.m_Position);
+	}
+	eventList.Compact();
+}
+
+void SSAM::EmitConflict(SP_Conflict c, const std::string& trjSrcName)
+{
+	if (IsConflictListed())
+	{
+		m_ConflictList.push_back(c); 
+		m_FileToConflictsMap[trjSrcName].push_back(c);
+	} else
+	{
+		if (m_IsRetainConflicts)
+			m_ConflictStore.Add(c);
+		if (m_pStreamSummary == NULL)
+			m_pStreamSummary = std::make_shared<Summary>("Unfiltered-All Files");
+		m_pStreamSummary->AddConflict(*c);
+		SP_Summary& pFileSummary = m_StreamSummaries[trjSrcName];
+		if (pFileSummary == NULL)
+			pFileSummary = std::make_shared<Summary>("Unfiltered-" + trjSrcName);
+		pFileSummary->AddConflict(*c);
+	}
+
+	if (m_pConflictSink != NULL)
+		m_pConflictSink->OnConflict(c);
 }
 
 void SSAM::CalcSummaries()
 {
 	m_Summaries.clear();
+	if (!IsConflictListed())
+	{
+		// the summaries were updated as the conflicts were found
+		if (m_pStreamSummary == NULL)
+			return;
+		m_pSummary = m_pStreamSummary;
+		m_Summaries.push_back(m_pSummary);
+		for (std::map<std::string, SP_Summary>::iterator it = m_StreamSummaries.begin();
+			it != m_StreamSummaries.end(); ++it)
+			m_Summaries.push_back(it->second);
+		return;
+	}
 	if (m_ConflictList.empty())
 		return;
 
@@ -486,11 +1409,22 @@ void SSAM::CalcSummaries()
 	}
 }
 
+void SSAM::ForEachConflict(const std::function<void(const Conflict&)>& f)
+{
+	if (!IsConflictListed())
+	{
+		m_ConflictStore.ForEach(f);
+		return;
+	}
+	for (std::list<SP_Conflict>::const_iterator it = m_ConflictList.begin(); it != m_ConflictList.end(); ++it)
+		f(**it);
+}
+
 void SSAM::ExportResults()
 {
 	try
 	{
-		if(m_ConflictList.empty())
+		if(GetNConflicts() == 0)
 			throw SSAMException("No conflicts to export to a .csv file.");
 		
 		std::ofstream csvFile(m_CsvFileName);
@@ -524,57 +1458,13 @@ void SSAM::ExportResults()
 		csvFile<< std::endl;
 		csvFile<< std::endl;
 
-		csvFile << "Conflict Listing," <<m_ConflictList.size() << "\n";
-		csvFile << "Time (min TTC),X (min PET), Y (min PET),Z (min PET), ConflictType, FristVID,SecondVID,TTC,PET,MaxS,DeltaS,DR,MaxD,xFirstCSP,yFirstCSP,xFirstCEP,yFirstCEP,xSecondCSP,ySecondCSP,xSecondCEP,ySecondCEP\n";
+		csvFile << "Conflict Listing," << GetNConflicts() << "\n";
+		CsvConflictSink::WriteListingLabels(csvFile);
 		
-		std::list<SP_Conflict>::iterator it = m_ConflictList.begin();
-		for (; it != m_ConflictList.end(); ++it)
+		ForEachConflict([&csvFile](const Conflict& c)
 		{
-			SP_Conflict c  = *it;
-			
-			csvFile<<c->tMinTTC;
-			csvFile<<",";
-			csvFile<<c->xMinPET;
-			csvFile<<",";
-			csvFile<<c->yMinPET;
-			csvFile<<",";
-			csvFile<<c->zMinPET;
-			csvFile<<",";
-			csvFile<<Conflict::CONFLICT_TYPE_LABEL[c->ConflictType];
-			csvFile<<",";
-			csvFile<<c->FirstVID;
-			csvFile<<",";
-			csvFile<<c->SecondVID;
-			csvFile<<",";
-			csvFile<<c->TTC;
-			csvFile<<",";
-			csvFile<<c->PET;
-			csvFile<<",";
-			csvFile<<c->MaxS;
-			csvFile<<",";
-			csvFile<<c->DeltaS;
-			csvFile<<",";
-			csvFile<<c->DR;
-			csvFile<<",";
-			csvFile<<c->MaxD;
-			csvFile<<",";
-			csvFile<<c->xFirstCSP;
-			csvFile<<",";
-			csvFile<<c->yFirstCSP;
-			csvFile<<",";
-			csvFile<<c->xFirstCEP;
-			csvFile<<",";
-			csvFile<<c->yFirstCEP;
-			csvFile<<",";
-			csvFile<<c->xSecondCSP;
-			csvFile<<",";
-			csvFile<<c->ySecondCSP;
-			csvFile<<",";
-			csvFile<<c->xSecondCEP;
-			csvFile<<",";
-			csvFile<<c->ySecondCEP;
-			csvFile<<std::endl;
-		}
+			CsvConflictSink::WriteListingRow(csvFile, c);
+		});
 		csvFile.close();
 			
 		std::cout << "Completed exporting to CSV file: " << m_CsvFileName <<std::endl;
@@ -588,16 +1478,14 @@ void SSAM::ExportResults()
 
 void SSAM::ReadTrjInputSize()
 {
-	int fileSize = 0;
+	long long fileSize = 0;
 	std::string unitStr (" bytes");
-	if (m_TrjFile.is_open())
+	if (m_TrjReader.IsOpen())
 	{
-		m_TrjFile.seekg(0, m_TrjFile.end);
-		fileSize = m_TrjFile.tellg();
-		m_TrjFile.seekg(0, m_TrjFile.beg);
-	} else if (!(m_TrjDataList.empty()))
+		fileSize = m_TrjReader.GetSize();
+	} else if (m_pTrjDataList != NULL)
 	{
-		fileSize = m_TrjDataList.size();
+		fileSize = m_pTrjDataList->size();
 		unitStr = " records";
 	}
 
@@ -612,11 +1500,12 @@ void SSAM::ReadInputFormat()
 {
 	try
 	{
-		m_Format.m_Endian = ReadByte(m_TrjFile);
-		m_Format.m_Version = ReadFloat(m_TrjFile);
+		m_Format.m_Endian = m_TrjReader.ReadByte();
+		m_TrjReader.SetEndian(m_Format.m_Endian);
+		m_Format.m_Version = m_TrjReader.ReadFloat();
 		if (m_Format.m_Version > ORIG_FORMAT_VERSION)
 		{
-			m_Format.m_ZOption = ReadByte(m_TrjFile);
+			m_Format.m_ZOption = m_TrjReader.ReadByte();
 		}
 	} catch (SSAMException &e)
 	{
@@ -630,12 +1519,12 @@ void SSAM::ReadDimensions()
 	try
 	{
 		m_pDimensions = std::make_shared<Dimensions>();
-		m_pDimensions->SetUnits(ReadByte(m_TrjFile));
-		m_pDimensions->SetScale(ReadFloat(m_TrjFile));
-		m_pDimensions->SetMinX(ReadInt(m_TrjFile));
-		m_pDimensions->SetMinY(ReadInt(m_TrjFile));
-		m_pDimensions->SetMaxX(ReadInt(m_TrjFile));
-		m_pDimensions->SetMaxY(ReadInt(m_TrjFile));
+		m_pDimensions->SetUnits(m_TrjReader.ReadByte());
+		m_pDimensions->SetScale(m_TrjReader.ReadFloat());
+		m_pDimensions->SetMinX(m_TrjReader.ReadInt());
+		m_pDimensions->SetMinY(m_TrjReader.ReadInt());
+		m_pDimensions->SetMaxX(m_TrjReader.ReadInt());
+		m_pDimensions->SetMaxY(m_TrjReader.ReadInt());
 	} catch (SSAMException &e)
 	{
 		std::string errMsg("Error in reading dimension record: ");
@@ -643,27 +1532,138 @@ void SSAM::ReadDimensions()
 	}
 }
 
-void SSAM::ReadVehicle(SP_Vehicle v)
+bool SSAM::ReadTimeStep(SP_TimeStepData& pStep)
 {
+	if (m_TrjCache.IsOpen())
+		return ReadCachedTimeStep(pStep);
+	if (m_TrjReader.IsEnd())
+		return false;
+
+	long long offset = m_TrjReader.GetPosition();
+	int recordType = m_TrjReader.ReadByte();
+	if (recordType == TrjRecord::VEHICLE)
+		throw SSAMException("Read error, VEHICLE data found before the first TIMESTEP data.");
+	if (recordType != TrjRecord::TIMESTEP)
+		throw SSAMException("Invalid trajectory record type (outside of header): " + std::to_string(recordType));
+
+	float t = 0;
 	try
 	{
-		v->SetVehicleID(ReadInt(m_TrjFile));
-		v->SetLinkID(ReadInt(m_TrjFile));
-		v->SetLaneID(ReadByte(m_TrjFile));
-		float vFrontX = ReadFloat(m_TrjFile);
-		float vFrontY = ReadFloat(m_TrjFile);
-		float vRearX = ReadFloat(m_TrjFile);
-		float vRearY = ReadFloat(m_TrjFile);
-		v->setScale(m_pDimensions->GetScale());					
-		v->SetLength(ReadFloat(m_TrjFile));
-		v->SetWidth(ReadFloat(m_TrjFile));
-		v->SetSpeed(ReadFloat(m_TrjFile));
-		v->SetAcceleration(ReadFloat(m_TrjFile));
-		v->SetPosition(vFrontX, vFrontY, vRearX, vRearY);
-		if (m_Format.m_Version > ORIG_FORMAT_VERSION)
+		t = m_TrjReader.ReadFloat();
+	} catch (SSAMException &e)
+	{
+		std::string errMsg("Error in reading time step record: ");
+		ThrowFileReadingException(e, errMsg);
+	}
+	pStep = std::make_shared<TimeStepData>(m_VehiclePool.Acquire());
+	pStep->SetTimestep(t);
+	if (m_IsWriteDat)
+		PrintTimeStep(t);
+	m_IsFirstTimeStep = false;
+
+	int nVehicles = 0;
+	while (!m_TrjReader.IsEnd())
+	{
+		const char* p = m_TrjReader.Require(1);
+		recordType = *p;
+		if (recordType == TrjRecord::TIMESTEP)
+		{
+			// leave the next time step record for the next call
+			m_TrjReader.Seek(m_TrjReader.GetPosition() - 1);
+			break;
+		} else if (recordType != TrjRecord::VEHICLE)
+		{
+			throw SSAMException("Invalid trajectory record type (outside of header): " + std::to_string(recordType));
+		}
+
+		Vehicle& v = pStep->NewVehicle();
+		v.SetTimeStep(t);
+		ReadVehicle(v); 
+		++nVehicles;
+		if (m_IsWriteDat)
+			v.Print(m_DatFile, m_Format.m_Version);
+		if ( ValidateVehicle(v)) 
+			pStep->AddVehicle(v);
+		else
+			pStep->FreeVehicle();
+	}
+	pStep->BuildIndex();
+	if (m_IsBuildIndex)
+		m_ReadIndex.AddEntry(t, offset, nVehicles);
+	return true;
+}
+
+bool SSAM::ReadCachedTimeStep(SP_TimeStepData& pStep)
+{
+	if (m_CacheStep >= m_TrjCache.GetNSteps())
+		return false;
+
+	TrjCache::Block b = m_TrjCache.GetBlock(m_CacheStep++);
+	float t = b.m_TimeStep;
+	pStep = std::make_shared<TimeStepData>(m_VehiclePool.Acquire());
+	pStep->SetTimestep(t);
+	if (m_IsWriteDat)
+		PrintTimeStep(t);
+	m_IsFirstTimeStep = false;
+
+	float scale = m_pDimensions->GetScale();
+	for (int i = 0; i < b.m_NVehicles; ++i)
+	{
+		Vehicle& v = pStep->NewVehicle();
+		v.SetTimeStep(t);
+		v.SetVehicleID(b.m_VehicleID[i]);
+		v.SetLinkID(b.m_LinkID[i]);
+		v.SetLaneID(b.m_LaneID[i]);
+		v.setScale(scale);
+		v.SetLength(b.m_Length[i]);
+		v.SetWidth(b.m_Width[i]);
+		v.SetSpeed(b.m_Speed[i]);
+		v.SetAcceleration(b.m_Acceleration[i]);
+		v.SetPosition(b.m_FrontX[i], b.m_FrontY[i], b.m_RearX[i], b.m_RearY[i]);
+		if (b.m_FrontZ != NULL)
+		{
+			v.SetFrontZ(b.m_FrontZ[i]);
+			v.SetRearZ(b.m_RearZ[i]);
+		}
+		if (m_IsWriteDat)
+			v.Print(m_DatFile, m_Format.m_Version);
+		if ( ValidateVehicle(v)) 
+			pStep->AddVehicle(v);
+		else
+			pStep->FreeVehicle();
+	}
+	pStep->BuildIndex();
+	return true;
+}
+
+void SSAM::ReadVehicle(Vehicle& v)
+{
+	try
+	{
+		// all fields of a vehicle record are decoded from one claimed buffer
+		bool hasZ = (m_Format.m_Version > ORIG_FORMAT_VERSION);
+		const int F = TrjReader::FLOAT_SIZE;
+		const int I = TrjReader::INT_SIZE;
+		const char* p = m_TrjReader.Require(TrjIndex::GetVehicleRecordSize(m_Format.m_Version));
+		v.SetVehicleID(m_TrjReader.GetInt(p));
+		v.SetLinkID(m_TrjReader.GetInt(p + I));
+		p += 2*I;
+		v.SetLaneID(*p);
+		p += 1;
+		float vFrontX = m_TrjReader.GetFloat(p);
+		float vFrontY = m_TrjReader.GetFloat(p + F);
+		float vRearX = m_TrjReader.GetFloat(p + 2*F);
+		float vRearY = m_TrjReader.GetFloat(p + 3*F);
+		v.setScale(m_pDimensions->GetScale());					
+		v.SetLength(m_TrjReader.GetFloat(p + 4*F));
+		v.SetWidth(m_TrjReader.GetFloat(p + 5*F));
+		v.SetSpeed(m_TrjReader.GetFloat(p + 6*F));
+		v.SetAcceleration(m_TrjReader.GetFloat(p + 7*F));
+		v.SetPosition(vFrontX, vFrontY, vRearX, vRearY);
+		if (hasZ)
 		{
-			v->SetFrontZ( ReadFloat(m_TrjFile));
-			v->SetRearZ( ReadFloat(m_TrjFile));
+			v.SetFrontZ(m_TrjReader.GetFloat(p + 8*F));
+			v.SetRearZ(m_TrjReader.GetFloat(p + 9*F));
 		}
 	} catch (SSAMException &e)
 	{
@@ -685,17 +1685,17 @@ void SSAM::ValidateInputFormat()
 		m_Format.Print(m_DatFile);
 }
 
-bool SSAM::ValidateVehicle(SP_Vehicle v)
+bool SSAM::ValidateVehicle(const Vehicle& v)
 {
-	return ((v->GetCenterX() >= m_pDimensions->GetMinX() 
-			  && v->GetCenterX() <= m_pDimensions->GetMaxX())
-			&& (v->GetCenterY() >= m_pDimensions->GetMinY() 
-			  && v->GetCenterY() <= m_pDimensions->GetMaxY())) ;
+	return ((v.GetCenterX() >= m_pDimensions->GetMinX() 
+			  && v.GetCenterX() <= m_pDimensions->GetMaxX())
+			&& (v.GetCenterY() >= m_pDimensions->GetMinY() 
+			  && v.GetCenterY() <= m_pDimensions->GetMaxY())) ;
 }
 
 void SSAM::ThrowFileReadingException(SSAMException &e, std::string& errMsg)
 {
-	if (m_TrjFile.eof())
+	if (m_TrjReader.IsEof())
 	{
 		errMsg += "End of trj file is reached. \n";
 	} else 
@@ -705,6 +1705,13 @@ void SSAM::ThrowFileReadingException(SSAMException &e, std::string& errMsg)
 	throw SSAMException(errMsg);
 }
 
+void SSAM::PrintReadThroughput(long long nBytes, double seconds)
+{
+	double mbPerSec = (seconds > 0) ? nBytes / seconds / (1024.0 * 1024.0) : 0;
+	std::cout << "Read " << nBytes << " bytes of " << m_TrjSrcName 
+		<< " in " << seconds << " s (" << mbPerSec << " MB/s)" << std::endl;
+}
+
 void SSAM::PrintTimeStep(float t)
 {
 	if (m_IsFirstTimeStep)
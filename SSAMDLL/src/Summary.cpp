@@ -30,6 +30,7 @@ const std::string Summary::SUMMARY_LABEL[Summary::NUM_SUMMARY_LABELS] =
 };
 
 Summary::Summary(const std::string& trjFile, const std::list<SP_Conflict>&	conflictList)
+	: m_NConflicts(0)
 {
 	if (conflictList.empty())
 	{
@@ -37,44 +38,41 @@ Summary::Summary(const std::string& trjFile, const std::list<SP_Conflict>&	confl
 	}
 
 	m_TrjFile = trjFile;
-	//	Initialize the summary values
-	for(int m = 0; m < Conflict::NUM_MEASURES; m++)
+	std::list<SP_Conflict>::const_iterator i = conflictList.begin();
+	for (; i != conflictList.end(); ++i)
+		AddConflict(**i);
+}
+
+void Summary::AddConflict(const Conflict& c)
+{
+	if (m_NConflicts == 0)
 	{
-		m_MinVals.push_back(FLT_MAX);
-		m_MaxVals.push_back(-FLT_MAX);
-		m_MeanVals.push_back(0);
-		m_VarVals.push_back(0);
-	}
+		//	Initialize the summary values
+		m_MinVals.assign(Conflict::NUM_MEASURES, FLT_MAX);
+		m_MaxVals.assign(Conflict::NUM_MEASURES, -FLT_MAX);
+		m_MeanVals.assign(Conflict::NUM_MEASURES, 0);
+		m_VarVals.assign(Conflict::NUM_MEASURES, 0);
 
-	// initialize the conflict counts
-	m_ConflictCounts.resize(Conflict::NUM_CONFLICT_TYPES+1, 0);
+		// initialize the conflict counts
+		m_ConflictCounts.assign(Conflict::NUM_CONFLICT_TYPES+1, 0);
+	}
 
-	//	Iterate through the conflicts and update the measures
-	int count = 0;
-	int nConflicts = 0;
+	//	update the measures
 	float measure = 0.0;
 	float prevMean = 0.0;
-	std::list<SP_Conflict>::const_iterator i = conflictList.begin();
-	for (; i != conflictList.end(); ++i)
+	for(int m = 0; m < Conflict::NUM_MEASURES; m++)
 	{
-		SP_Conflict c = *i;
-		
-		for(int m = 0; m < Conflict::NUM_MEASURES; m++)
-		{
-			measure = c->GetMeasure(m);
-			m_MinVals[count] = std::min(m_MinVals[count], measure);
-			m_MaxVals[count] = std::max(m_MaxVals[count], measure);
-			//	calculate mean and variance in stream to prevent overflow
-			prevMean = m_MeanVals[count];
-			m_MeanVals[count]	= m_MeanVals[count] + (measure - m_MeanVals[count])/(float)(nConflicts + 1);
-			if(nConflicts > 0)
-				m_VarVals[count] = (m_VarVals[count]*(1.0 - 1.0/(float)nConflicts) + (float)(nConflicts + 1)*(m_MeanVals[count]-prevMean)*(m_MeanVals[count]-prevMean));
-			count++;
-		}
-		count = 0;
-		nConflicts++;
-		
-		m_ConflictCounts[c->ConflictType]++;
-		m_ConflictCounts[Conflict::NUM_CONFLICT_TYPES]++; 
+		measure = c.GetMeasure(m);
+		m_MinVals[m] = std::min(m_MinVals[m], measure);
+		m_MaxVals[m] = std::max(m_MaxVals[m], measure);
+		//	calculate mean and variance in stream to prevent overflow
+		prevMean = m_MeanVals[m];
+		m_MeanVals[m]	= m_MeanVals[m] + (measure - m_MeanVals[m])/(float)(m_NConflicts + 1);
+		if(m_NConflicts > 0)
+			m_VarVals[m] = (m_VarVals[m]*(1.0 - 1.0/(float)m_NConflicts) + (float)(m_NConflicts + 1)*(m_MeanVals[m]-prevMean)*(m_MeanVals[m]-prevMean));
 	}
-}
\ No newline at end of file
+	m_NConflicts++;
+	
+	m_ConflictCounts[c.ConflictType]++;
+	m_ConflictCounts[Conflict::NUM_CONFLICT_TYPES]++; 
+}
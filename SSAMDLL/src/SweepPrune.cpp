@@ -0,0 +1,328 @@
+/*------------------------------------------------------------------------------
+   Copyright  2016-2017
+   New Global Systems for Intelligent Transportation Management Corp.
+
+   This file is part of SSAM.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Affero General Public License as
+   published by the Free Software Foundation, either version 3 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------------*/
+#include "stdafx.h"
+#include <algorithm>
+#include <limits>
+#include "SweepPrune.h"
+#ifdef _OPENMP_LOCAL
+#include <omp.h>
+#endif
+
+namespace
+{
+	/** KeyLess orders footprint indexes by the start of the footprints along the sweep axis, then by index
+	*/
+	struct KeyLess
+	{
+		explicit KeyLess(const std::vector<float>& keys) : m_pKeys(&keys[0]) {}
+
+		bool operator()(int a, int b) const
+		{
+			return m_pKeys[a] < m_pKeys[b] || (m_pKeys[a] == m_pKeys[b] && a < b);
+		}
+
+		const float* m_pKeys; /*!< Start of the footprints along the axis, by footprint index */
+	};
+}
+
+SweepPrune::SweepPrune()
+	: m_AreaMinX(0)
+	, m_AreaMinY(0)
+	, m_AreaMaxX(0)
+	, m_AreaMaxY(0)
+	, m_Axis(X_AXIS)
+	, m_NFullSorts(0)
+{
+}
+
+SweepPrune::SweepPrune(int xMin, int yMin, int xMax, int yMax)
+	: m_Axis(X_AXIS)
+	, m_NFullSorts(0)
+{
+	ResetArea(xMin, yMin, xMax, yMax);
+}
+
+void SweepPrune::ResetArea(int xMin, int yMin, int xMax, int yMax)
+{
+	m_AreaMinX = xMin;
+	m_AreaMinY = yMin;
+	m_AreaMaxX = xMax;
+	m_AreaMaxY = yMax;
+	m_Order.clear();
+}
+
+void SweepPrune::Build(const VehicleShapes& shapes, const std::vector<int>& vehicles)
+{
+	if (vehicles.empty())
+	{
+		m_Order.clear();
+		m_Marks.clear();
+		return;
+	}
+	size_t nShapes = vehicles.back() + 1;
+	m_Marks.assign(nShapes, 0);
+	for (size_t k = 0; k < vehicles.size(); ++k)
+	{
+		int i = vehicles[k];
+		if (!(shapes.GetCenterX(i) < m_AreaMinX || shapes.GetCenterX(i) > m_AreaMaxX) && 
+			!(shapes.GetCenterY(i) < m_AreaMinY || shapes.GetCenterY(i) > m_AreaMaxY))
+			m_Marks[i] = 1;
+	}
+
+	int axis = ChooseAxis(shapes, vehicles);
+	if (axis != m_Axis)
+	{
+		m_Axis = axis;
+		m_Order.clear();
+	}
+	int nVehicles = (int)vehicles.size();
+	m_Keys.resize(nShapes);
+#ifdef _OPENMP_LOCAL
+	#pragma omp parallel for
+#endif
+	for (int k = 0; k < nVehicles; ++k)
+	{
+		int i = vehicles[k];
+		m_Keys[i] = (m_Axis == X_AXIS) ? shapes.GetMinX(i) : shapes.GetMinY(i);
+	}
+
+	//	the vehicles still in the area keep the order of the previous time step,
+	//	and the vehicles entering it are sorted apart and merged in
+	int nCarried = 0;
+	for (size_t k = 0; k < m_Order.size(); ++k)
+	{
+		int i = m_Order[k];
+		if (i >= 0 && (size_t)i < nShapes && m_Marks[i] == 1)
+		{
+			m_Marks[i] = 2;
+			m_Order[nCarried++] = i;
+		}
+	}
+	m_Order.resize(nCarried);
+	for (size_t k = 0; k < vehicles.size(); ++k)
+	{
+		if (m_Marks[vehicles[k]] == 1)
+		{
+			m_Marks[vehicles[k]] = 2;
+			m_Order.push_back(vehicles[k]);
+		}
+	}
+
+	KeyLess less(m_Keys);
+	if (!InsertionSort(0, nCarried))
+	{
+		++m_NFullSorts;
+		std::sort(m_Order.begin(), m_Order.begin() + nCarried, less);
+	}
+	std::sort(m_Order.begin() + nCarried, m_Order.end(), less);
+	std::inplace_merge(m_Order.begin(), m_Order.begin() + nCarried, m_Order.end(), less);
+
+	//	the sweep reads the extents of the footprints in the sorted order
+	int n = (int)m_Order.size();
+	m_MinKeys.resize(n);
+	m_MaxKeys.resize(n);
+	m_CrossMins.resize(n);
+	m_CrossMaxs.resize(n);
+#ifdef _OPENMP_LOCAL
+	#pragma omp parallel for
+#endif
+	for (int p = 0; p < n; ++p)
+	{
+		int i = m_Order[p];
+		m_MinKeys[p] = m_Keys[i];
+		if (m_Axis == X_AXIS)
+		{
+			m_MaxKeys[p] = shapes.GetMaxX(i);
+			m_CrossMins[p] = shapes.GetMinY(i);
+			m_CrossMaxs[p] = shapes.GetMaxY(i);
+		}
+		else
+		{
+			m_MaxKeys[p] = shapes.GetMaxY(i);
+			m_CrossMins[p] = shapes.GetMinX(i);
+			m_CrossMaxs[p] = shapes.GetMaxX(i);
+		}
+	}
+}
+
+void SweepPrune::FindCrashes(const VehicleShapes& shapes, std::vector<std::pair<int, int> >& crashes)
+{
+#ifdef _OPENMP_LOCAL
+	m_CrashBuffers.resize(omp_get_max_threads());
+#else
+	m_CrashBuffers.resize(1);
+#endif
+	for (size_t t = 0; t < m_CrashBuffers.size(); ++t)
+	{
+		m_CrashBuffers[t].m_Overlaps.clear();
+		m_CrashBuffers[t].m_Crashes.clear();
+	}
+
+	//	a footprint overlaps along the axis the footprints sorted after it that start before it ends
+	int n = (int)m_Order.size();
+#ifdef _OPENMP_LOCAL
+	#pragma omp parallel for schedule(dynamic, 64)
+#endif
+	for (int p = 0; p < n; ++p)
+	{
+#ifdef _OPENMP_LOCAL
+		CrashBuffer& buffer = m_CrashBuffers[omp_get_thread_num()];
+#else
+		CrashBuffer& buffer = m_CrashBuffers[0];
+#endif
+		int a = m_Order[p];
+		float maxKey = m_MaxKeys[p];
+		float crossMin = m_CrossMins[p];
+		float crossMax = m_CrossMaxs[p];
+		for (int q = p + 1; q < n && m_MinKeys[q] <= maxKey; ++q)
+		{
+			if (m_CrossMins[q] <= crossMax && m_CrossMaxs[q] >= crossMin)
+			{
+				int b = m_Order[q];
+				buffer.m_Overlaps.push_back(std::pair<int, int>(std::max(a, b), std::min(a, b)));
+			}
+		}
+	}
+
+	//	a pair is checked with the higher index as the vehicle and the lower as the candidate,
+	//	as the zone grid does, so the candidates are grouped by the higher index
+	int nShapes = (int)m_Marks.size();
+	m_CandidateStarts.assign(nShapes + 1, 0);
+	for (size_t t = 0; t < m_CrashBuffers.size(); ++t)
+	{
+		const std::vector<std::pair<int, int> >& overlaps = m_CrashBuffers[t].m_Overlaps;
+		for (size_t k = 0; k < overlaps.size(); ++k)
+			++m_CandidateStarts[overlaps[k].first + 1];
+	}
+	for (int i = 0; i < nShapes; ++i)
+		m_CandidateStarts[i + 1] += m_CandidateStarts[i];
+	m_Candidates.resize(m_CandidateStarts[nShapes]);
+	for (size_t t = 0; t < m_CrashBuffers.size(); ++t)
+	{
+		const std::vector<std::pair<int, int> >& overlaps = m_CrashBuffers[t].m_Overlaps;
+		for (size_t k = 0; k < overlaps.size(); ++k)
+			m_Candidates[m_CandidateStarts[overlaps[k].first]++] = overlaps[k].second;
+	}
+	for (int i = nShapes; i > 0; --i)
+		m_CandidateStarts[i] = m_CandidateStarts[i - 1];
+	m_CandidateStarts[0] = 0;
+
+#ifdef _OPENMP_LOCAL
+	#pragma omp parallel for schedule(dynamic, 64)
+#endif
+	for (int i = 0; i < nShapes; ++i)
+	{
+		int nCandidates = m_CandidateStarts[i + 1] - m_CandidateStarts[i];
+		if (nCandidates == 0)
+			continue;
+#ifdef _OPENMP_LOCAL
+		CrashBuffer& buffer = m_CrashBuffers[omp_get_thread_num()];
+#else
+		CrashBuffer& buffer = m_CrashBuffers[0];
+#endif
+		buffer.m_Found.clear();
+		shapes.FindCollisions(i, &m_Candidates[m_CandidateStarts[i]], nCandidates, buffer.m_Found);
+		for (size_t c = 0; c < buffer.m_Found.size(); ++c)
+			buffer.m_Crashes.push_back(std::pair<int, int>(buffer.m_Found[c], i));
+	}
+
+	//	merge the crashes of the threads in an order that does not depend on the threads
+	crashes.clear();
+	for (size_t t = 0; t < m_CrashBuffers.size(); ++t)
+		crashes.insert(crashes.end(), m_CrashBuffers[t].m_Crashes.begin(), m_CrashBuffers[t].m_Crashes.end());
+	std::sort(crashes.begin(), crashes.end());
+}
+
+void SweepPrune::CarryOrder(const StepVehicles& step)
+{
+	for (size_t k = 0; k < m_Order.size(); ++k)
+	{
+		int i = m_Order[k];
+		m_Order[k] = (i >= 0 && (size_t)i < step.size()) ? step[i]->GetNextIndex() : -1;
+	}
+}
+
+int SweepPrune::ChooseAxis(const VehicleShapes& shapes, const std::vector<int>& vehicles) const
+{
+	double extent[2] = {0, 0};
+	float centerMin[2] = {0, 0};
+	float centerMax[2] = {0, 0};
+	bool isFirst = true;
+	for (size_t k = 0; k < vehicles.size(); ++k)
+	{
+		int i = vehicles[k];
+		if (m_Marks[i] == 0)
+			continue;
+		extent[X_AXIS] += shapes.GetMaxX(i) - shapes.GetMinX(i);
+		extent[Y_AXIS] += shapes.GetMaxY(i) - shapes.GetMinY(i);
+		float center[2] = {shapes.GetCenterX(i), shapes.GetCenterY(i)};
+		for (int a = 0; a < 2; ++a)
+		{
+			if (isFirst || center[a] < centerMin[a])
+				centerMin[a] = center[a];
+			if (isFirst || center[a] > centerMax[a])
+				centerMax[a] = center[a];
+		}
+		isFirst = false;
+	}
+	if (isFirst)
+		return m_Axis;
+
+	//	the footprints overlap along an axis about in proportion to their length over the spread of the vehicles;
+	//	the axis is changed only if the other axis saves a tenth of the overlaps, so that it does not flip
+	double cost[2];
+	for (int a = 0; a < 2; ++a)
+	{
+		double spread = centerMax[a] - centerMin[a];
+		cost[a] = (spread > 0) ? extent[a] / spread : std::numeric_limits<double>::infinity();
+	}
+	int other = 1 - m_Axis;
+	if (10 * (cost[m_Axis] - cost[other]) >= cost[m_Axis])
+		return other;
+	return m_Axis;
+}
+
+bool SweepPrune::InsertionSort(int first, int last)
+{
+	KeyLess less(m_Keys);
+	//	beyond about the compares of a full sort, insertion is slower than sorting from scratch
+	long long n = last - first;
+	long long maxShifts = 16;
+	for (long long m = n; m > 1; m /= 2)
+		maxShifts += n;
+	long long nShifts = 0;
+	for (int k = first + 1; k < last; ++k)
+	{
+		int i = m_Order[k];
+		int j = k;
+		while (j > first && less(i, m_Order[j - 1]))
+		{
+			m_Order[j] = m_Order[j - 1];
+			--j;
+			if (++nShifts > maxShifts)
+			{
+				m_Order[j] = i;
+				return false;
+			}
+		}
+		m_Order[j] = i;
+	}
+	return true;
+}
@@ -0,0 +1,123 @@
+/*------------------------------------------------------------------------------
+   Copyright  2016-2017
+   New Global Systems for Intelligent Transportation Management Corp.
+
+   This file is part of SSAM.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Affero General Public License as
+   published by the Free Software Foundation, either version 3 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------------*/
+#include "stdafx.h"
+#include <cmath>
+#include <algorithm>
+#include "TTCSolver.h"
+
+bool TTCSolver::FindFirstContact(const std::vector<PathPiece>& pathA, const std::vector<PathPiece>& pathB, float& ttc)
+{
+	// the pieces of both paths are visited in the order of time, so the first contact found is the earliest
+	size_t i = 0, j = 0;
+	while (i < pathA.size() && j < pathB.size())
+	{
+		const PathPiece& a = pathA[i];
+		const PathPiece& b = pathB[j];
+		float startTime = std::max(a.m_StartTime, b.m_StartTime);
+		float endTime = std::min(a.m_EndTime, b.m_EndTime);
+		if (startTime <= endTime && FindPieceContact(a, b, startTime, endTime, ttc))
+			return true;
+
+		if (a.m_EndTime < b.m_EndTime)
+			++i;
+		else if (b.m_EndTime < a.m_EndTime)
+			++j;
+		else
+		{
+			++i;
+			++j;
+		}
+	}
+	return false;
+}
+
+bool TTCSolver::FindPieceContact(const PathPiece& a, const PathPiece& b, float startTime, float endTime, float& ttc)
+{
+	// considered as at two levels if more than 5 ft apart in elevation
+	if (abs(a.m_CenterZ - b.m_CenterZ) > 5.0)
+		return false;
+
+	// corners at startTime, b moving relative to a
+	float ax[4], ay[4], bx[4], by[4];
+	float dtA = startTime - a.m_StartTime;
+	float dtB = startTime - b.m_StartTime;
+	for (int k = 0; k < 4; ++k)
+	{
+		ax[k] = a.m_CornerX[k] + dtA * a.m_VelocityX;
+		ay[k] = a.m_CornerY[k] + dtA * a.m_VelocityY;
+		bx[k] = b.m_CornerX[k] + dtB * b.m_VelocityX;
+		by[k] = b.m_CornerY[k] + dtB * b.m_VelocityY;
+	}
+	float relVX = b.m_VelocityX - a.m_VelocityX;
+	float relVY = b.m_VelocityY - a.m_VelocityY;
+
+	// the footprints overlap at time startTime + tau for tau in [tauMin, tauMax]
+	float tauMin = 0;
+	float tauMax = endTime - startTime;
+	for (int axis = 0; axis < 8; ++axis)
+	{
+		// the normals of the edges of both footprints
+		const float* x = axis < 4 ? ax : bx;
+		const float* y = axis < 4 ? ay : by;
+		int k = axis % 4;
+		float nx = -(y[(k+1)%4] - y[k]);
+		float ny = x[(k+1)%4] - x[k];
+		if (nx == 0 && ny == 0)
+			continue;
+
+		float minA = ax[0]*nx + ay[0]*ny;
+		float maxA = minA;
+		float minB = bx[0]*nx + by[0]*ny;
+		float maxB = minB;
+		for (int c = 1; c < 4; ++c)
+		{
+			float projA = ax[c]*nx + ay[c]*ny;
+			float projB = bx[c]*nx + by[c]*ny;
+			if (projA < minA)
+				minA = projA;
+			if (projA > maxA)
+				maxA = projA;
+			if (projB < minB)
+				minB = projB;
+			if (projB > maxB)
+				maxB = projB;
+		}
+
+		float rate = relVX*nx + relVY*ny;
+		if (rate == 0)
+		{
+			if (maxB < minA || minB > maxA)
+				return false;
+			continue;
+		}
+		float tauEnter = (minA - maxB)/rate;
+		float tauLeave = (maxA - minB)/rate;
+		if (rate < 0)
+			std::swap(tauEnter, tauLeave);
+		if (tauEnter > tauMin)
+			tauMin = tauEnter;
+		if (tauLeave < tauMax)
+			tauMax = tauLeave;
+		if (tauMin > tauMax)
+			return false;
+	}
+	ttc = startTime + tauMin;
+	return true;
+}
@@ -0,0 +1,232 @@
+/*------------------------------------------------------------------------------
+   Copyright  2016-2017
+   New Global Systems for Intelligent Transportation Management Corp.
+
+   This file is part of SSAM.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Affero General Public License as
+   published by the Free Software Foundation, either version 3 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------------*/
+#include "stdafx.h"
+#include "TrjCache.h"
+#include "SSAM.h"
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+
+using namespace SSAMFuncs;
+
+const char TrjCache::MAGIC[8] = {'S', 'S', 'A', 'M', 'C', 'O', 'L', '1'};
+
+namespace
+{
+	const int BYTE_ORDER_MARK = 0x01020304;
+	const int DIRECTORY_ENTRY_SIZE = sizeof(float) + sizeof(int) + 2 * sizeof(long long);
+
+	bool IsStepBefore(const TrjIndex::Entry& e, long long trjOffset)
+	{
+		return e.m_Offset < trjOffset;
+	}
+
+	template <typename T>
+	void WriteValue(std::ofstream& file, const T& value)
+	{
+		file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template <typename T>
+	void WriteArray(std::ofstream& file, const std::vector<T>& values)
+	{
+		if (!values.empty())
+			file.write(reinterpret_cast<const char*>(&values[0]), values.size() * sizeof(T));
+	}
+
+	template <typename T>
+	T GetValue(const char*& p)
+	{
+		T value;
+		memcpy(&value, p, sizeof(T));
+		p += sizeof(T);
+		return value;
+	}
+}
+
+long long TrjCache::GetBlockSize(int nVehicles, bool hasZ)
+{
+	// ID and link arrays, float arrays, then the lane array
+	long long size = (long long)nVehicles * (2 * sizeof(int) + (hasZ ? 10 : 8) * sizeof(float) + 1);
+	return (size + 7) / 8 * 8;
+}
+
+bool TrjCache::Write(const std::string& cacheFileName, TrjReader& reader, const TrjIndex& index, const Header& header)
+{
+	std::ofstream file(cacheFileName.c_str(), std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	bool hasZ = (header.m_Version > ORIG_FORMAT_VERSION);
+	long long nSteps = (long long)index.GetSize();
+	file.write(MAGIC, sizeof(MAGIC));
+	WriteValue(file, BYTE_ORDER_MARK);
+	WriteValue(file, header);
+	WriteValue(file, nSteps);
+
+	// the blocks follow the directory, aligned to 8 bytes
+	long long headerSize = sizeof(MAGIC) + sizeof(int) + sizeof(Header) + sizeof(long long) + nSteps * DIRECTORY_ENTRY_SIZE;
+	long long blockOffset = (headerSize + 7) / 8 * 8;
+	for (size_t i = 0; i < index.GetSize(); ++i)
+	{
+		const TrjIndex::Entry& e = index.GetEntry(i);
+		WriteValue(file, e.m_TimeStep);
+		WriteValue(file, e.m_NVehicles);
+		WriteValue(file, e.m_Offset);
+		WriteValue(file, blockOffset);
+		blockOffset += GetBlockSize(e.m_NVehicles, hasZ);
+	}
+	for (long long pos = headerSize; pos % 8 != 0; ++pos)
+		file.put(0);
+
+	const int vehicleSize = TrjIndex::GetVehicleRecordSize(header.m_Version);
+	const int nFloats = hasZ ? 10 : 8;
+	std::vector<int> vehicleIDs;
+	std::vector<int> linkIDs;
+	std::vector<char> laneIDs;
+	std::vector<std::vector<float> > floats(nFloats);
+	for (size_t i = 0; i < index.GetSize() && file.good(); ++i)
+	{
+		const TrjIndex::Entry& e = index.GetEntry(i);
+		vehicleIDs.resize(e.m_NVehicles);
+		linkIDs.resize(e.m_NVehicles);
+		laneIDs.resize(e.m_NVehicles);
+		for (int f = 0; f < nFloats; ++f)
+			floats[f].resize(e.m_NVehicles);
+
+		// skip the TIMESTEP record, then each vehicle record has its type byte first
+		reader.Seek(e.m_Offset + 1 + TrjReader::FLOAT_SIZE);
+		for (int v = 0; v < e.m_NVehicles; ++v)
+		{
+			const char* p = reader.Require(1 + vehicleSize) + 1;
+			vehicleIDs[v] = reader.GetInt(p);
+			linkIDs[v] = reader.GetInt(p + TrjReader::INT_SIZE);
+			p += 2 * TrjReader::INT_SIZE;
+			laneIDs[v] = *p;
+			p += 1;
+			for (int f = 0; f < nFloats; ++f)
+				floats[f][v] = reader.GetFloat(p + f * TrjReader::FLOAT_SIZE);
+		}
+
+		WriteArray(file, vehicleIDs);
+		WriteArray(file, linkIDs);
+		for (int f = 0; f < nFloats; ++f)
+			WriteArray(file, floats[f]);
+		WriteArray(file, laneIDs);
+		long long size = (long long)e.m_NVehicles * (2 * sizeof(int) + nFloats * sizeof(float) + 1);
+		for (long long pos = size; pos < GetBlockSize(e.m_NVehicles, hasZ); ++pos)
+			file.put(0);
+	}
+	file.close();
+
+	if (file.fail())
+	{
+		std::remove(cacheFileName.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool TrjCache::Open(const std::string& cacheFileName, long long sourceSize, long long sourceTime)
+{
+	Close();
+	std::ifstream test(cacheFileName.c_str(), std::ios::binary);
+	if (!test.is_open())
+		return false;
+	test.close();
+
+	m_File.Open(cacheFileName);
+	long long headerSize = sizeof(MAGIC) + sizeof(int) + sizeof(Header) + sizeof(long long);
+	if (m_File.GetSize() < headerSize)
+	{
+		Close();
+		return false;
+	}
+
+	const char* p = m_File.GetView(0, (size_t)headerSize);
+	if (memcmp(p, MAGIC, sizeof(MAGIC)) != 0)
+	{
+		Close();
+		return false;
+	}
+	p += sizeof(MAGIC);
+	int byteOrderMark = GetValue<int>(p);
+	m_Header = GetValue<Header>(p);
+	long long nSteps = GetValue<long long>(p);
+	if (byteOrderMark != BYTE_ORDER_MARK || m_Header.m_SourceSize != sourceSize || m_Header.m_SourceTime != sourceTime
+		|| nSteps < 0 || headerSize + nSteps * DIRECTORY_ENTRY_SIZE > m_File.GetSize())
+	{
+		Close();
+		return false;
+	}
+
+	bool hasZ = (m_Header.m_Version > ORIG_FORMAT_VERSION);
+	p = m_File.GetView(headerSize, (size_t)(nSteps * DIRECTORY_ENTRY_SIZE));
+	for (long long i = 0; i < nSteps; ++i)
+	{
+		float t = GetValue<float>(p);
+		int nVehicles = GetValue<int>(p);
+		long long trjOffset = GetValue<long long>(p);
+		long long blockOffset = GetValue<long long>(p);
+		if (nVehicles < 0 || blockOffset % 8 != 0 || blockOffset + GetBlockSize(nVehicles, hasZ) > m_File.GetSize())
+		{
+			Close();
+			return false;
+		}
+		m_Index.AddEntry(t, trjOffset, nVehicles);
+		m_BlockOffsets.push_back(blockOffset);
+	}
+	return true;
+}
+
+TrjCache::Block TrjCache::GetBlock(size_t i)
+{
+	const TrjIndex::Entry& e = m_Index.GetEntry(i);
+	bool hasZ = (m_Header.m_Version > ORIG_FORMAT_VERSION);
+	size_t n = e.m_NVehicles;
+
+	Block b = Block();
+	b.m_TimeStep = e.m_TimeStep;
+	b.m_NVehicles = e.m_NVehicles;
+	if (n == 0)
+		return b;
+	const char* p = m_File.GetView(m_BlockOffsets[i], (size_t)GetBlockSize(e.m_NVehicles, hasZ));
+	b.m_VehicleID = reinterpret_cast<const int*>(p);
+	b.m_LinkID = b.m_VehicleID + n;
+	const float* floats = reinterpret_cast<const float*>(b.m_LinkID + n);
+	b.m_FrontX = floats;
+	b.m_FrontY = floats + n;
+	b.m_RearX = floats + 2*n;
+	b.m_RearY = floats + 3*n;
+	b.m_Length = floats + 4*n;
+	b.m_Width = floats + 5*n;
+	b.m_Speed = floats + 6*n;
+	b.m_Acceleration = floats + 7*n;
+	b.m_FrontZ = hasZ ? floats + 8*n : NULL;
+	b.m_RearZ = hasZ ? floats + 9*n : NULL;
+	b.m_LaneID = reinterpret_cast<const char*>(floats + (hasZ ? 10 : 8)*n);
+	return b;
+}
+
+size_t TrjCache::FindStep(long long trjOffset) const
+{
+	const std::vector<TrjIndex::Entry>& entries = m_Index.GetEntries();
+	return std::lower_bound(entries.begin(), entries.end(), trjOffset, IsStepBefore) - entries.begin();
+}
@@ -0,0 +1,145 @@
+/*------------------------------------------------------------------------------
+   Copyright  2016-2017
+   New Global Systems for Intelligent Transportation Management Corp.
+
+   This file is part of SSAM.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Affero General Public License as
+   published by the Free Software Foundation, either version 3 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------------*/
+#include "stdafx.h"
+#include "TrjIndex.h"
+#include "SSAM.h"
+#include <algorithm>
+#include <fstream>
+
+using namespace SSAMFuncs;
+
+const char TrjIndex::MAGIC[8] = {'S', 'S', 'A', 'M', 'I', 'D', 'X', '1'};
+
+namespace
+{
+	bool IsEntryBefore(const TrjIndex::Entry& e, float t)
+	{
+		return e.m_TimeStep < t;
+	}
+
+	bool IsTimeBefore(float t, const TrjIndex::Entry& e)
+	{
+		return t < e.m_TimeStep;
+	}
+
+	template <typename T>
+	void WriteValue(std::ofstream& file, const T& value)
+	{
+		file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template <typename T>
+	bool ReadValue(std::ifstream& file, T& value)
+	{
+		return file.read(reinterpret_cast<char*>(&value), sizeof(T)).good();
+	}
+}
+
+void TrjIndex::Build(TrjReader& reader, float version)
+{
+	m_Entries.clear();
+	const int vehicleSize = GetVehicleRecordSize(version);
+	while (!reader.IsEnd())
+	{
+		long long offset = reader.GetPosition();
+		int recordType = reader.ReadByte();
+		if (recordType == TrjRecord::TIMESTEP)
+		{
+			Entry e;
+			e.m_TimeStep = reader.ReadFloat();
+			e.m_Offset = offset;
+			e.m_NVehicles = 0;
+			m_Entries.push_back(e);
+		} else if (recordType == TrjRecord::VEHICLE)
+		{
+			if (m_Entries.empty())
+				throw SSAMException("Read error, VEHICLE data found before the first TIMESTEP data.");
+			reader.Require(vehicleSize);
+			++m_Entries.back().m_NVehicles;
+		} else
+		{
+			throw SSAMException("Invalid trajectory record type (outside of header): " + std::to_string(recordType));
+		}
+	}
+}
+
+size_t TrjIndex::FindTimeStep(float t) const
+{
+	return std::lower_bound(m_Entries.begin(), m_Entries.end(), t, IsEntryBefore) - m_Entries.begin();
+}
+
+size_t TrjIndex::FindTimeStepAfter(float t) const
+{
+	return std::upper_bound(m_Entries.begin(), m_Entries.end(), t, IsTimeBefore) - m_Entries.begin();
+}
+
+bool TrjIndex::Save(const std::string& indexFileName, long long sourceSize, long long sourceTime) const
+{
+	// the index is a local cache of the TRJ file, so values are written in native byte order
+	std::ofstream file(indexFileName.c_str(), std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+	file.write(MAGIC, sizeof(MAGIC));
+	WriteValue(file, sourceSize);
+	WriteValue(file, sourceTime);
+	WriteValue(file, (long long)m_Entries.size());
+	for (size_t i = 0; i < m_Entries.size(); ++i)
+	{
+		WriteValue(file, m_Entries[i].m_TimeStep);
+		WriteValue(file, m_Entries[i].m_Offset);
+		WriteValue(file, m_Entries[i].m_NVehicles);
+	}
+	file.close();
+	return !file.fail();
+}
+
+bool TrjIndex::Load(const std::string& indexFileName, long long sourceSize, long long sourceTime)
+{
+	m_Entries.clear();
+	std::ifstream file(indexFileName.c_str(), std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	char magic[sizeof(MAGIC)];
+	long long size = 0;
+	long long time = 0;
+	long long nEntries = 0;
+	if (!file.read(magic, sizeof(magic)) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0
+		|| !ReadValue(file, size) || !ReadValue(file, time) || !ReadValue(file, nEntries)
+		|| size != sourceSize || time != sourceTime || nEntries < 0 || nEntries > sourceSize)
+		return false;
+
+	std::vector<Entry> entries((size_t)nEntries);
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		Entry& e = entries[i];
+		if (!ReadValue(file, e.m_TimeStep) || !ReadValue(file, e.m_Offset) || !ReadValue(file, e.m_NVehicles)
+			|| e.m_Offset < 0 || e.m_Offset >= sourceSize)
+			return false;
+	}
+	m_Entries.swap(entries);
+	return true;
+}
+
+int TrjIndex::GetVehicleRecordSize(float version)
+{
+	bool hasZ = (version > ORIG_FORMAT_VERSION);
+	return 2*TrjReader::INT_SIZE + 1 + (hasZ ? 10 : 8)*TrjReader::FLOAT_SIZE;
+}
@@ -0,0 +1,178 @@
+/*------------------------------------------------------------------------------
+   Copyright  2016-2017
+   New Global Systems for Intelligent Transportation Management Corp.
+
+   This file is part of SSAM.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Affero General Public License as
+   published by the Free Software Foundation, either version 3 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------------*/
+#include "stdafx.h"
+#include "TrjReader.h"
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// a 64-bit process maps the whole file at once,
+	// a 32-bit process slides a view over the file
+	const long long MAX_VIEW_SIZE = (sizeof(void*) >= 8) ? (1LL << 40) : (64LL << 20);
+
+	long long GetAllocationGranularity()
+	{
+#ifdef _WIN32
+		SYSTEM_INFO sysInfo;
+		GetSystemInfo(&sysInfo);
+		return sysInfo.dwAllocationGranularity;
+#else
+		return sysconf(_SC_PAGESIZE);
+#endif
+	}
+}
+
+MappedFile::MappedFile()
+	: m_IsOpen(false)
+	, m_Size(0)
+	, m_ModifiedTime(0)
+	, m_pView(NULL)
+	, m_ViewOffset(0)
+	, m_ViewSize(0)
+	, m_hFile(NULL)
+	, m_hMapping(NULL)
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+void MappedFile::Open(const std::string& fileName)
+{
+	Close();
+	m_FileName = fileName;
+#ifdef _WIN32
+	HANDLE hFile = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+		throw SSAMException("File \"" + fileName + "\" does not exist.");
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(hFile, &size))
+	{
+		CloseHandle(hFile);
+		throw SSAMException("File \"" + fileName + "\" size could not be read.");
+	}
+	FILETIME writeTime;
+	if (!GetFileTime(hFile, NULL, NULL, &writeTime))
+	{
+		CloseHandle(hFile);
+		throw SSAMException("File \"" + fileName + "\" time could not be read.");
+	}
+	m_hFile = hFile;
+	m_Size = size.QuadPart;
+	m_ModifiedTime = ((long long)writeTime.dwHighDateTime << 32) | writeTime.dwLowDateTime;
+	if (m_Size > 0)
+	{
+		m_hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (m_hMapping == NULL)
+		{
+			CloseHandle(hFile);
+			m_hFile = NULL;
+			throw SSAMException("File \"" + fileName + "\" could not be mapped into memory.");
+		}
+	}
+#else
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw SSAMException("File \"" + fileName + "\" does not exist.");
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		close(fd);
+		throw SSAMException("File \"" + fileName + "\" size could not be read.");
+	}
+	m_hFile = new int(fd);
+	m_Size = st.st_size;
+	m_ModifiedTime = st.st_mtime;
+#endif
+	m_IsOpen = true;
+}
+
+void MappedFile::Close()
+{
+	UnmapView();
+#ifdef _WIN32
+	if (m_hMapping != NULL)
+		CloseHandle(m_hMapping);
+	if (m_hFile != NULL)
+		CloseHandle(m_hFile);
+#else
+	if (m_hFile != NULL)
+	{
+		int* pFd = static_cast<int*>(m_hFile);
+		close(*pFd);
+		delete pFd;
+	}
+#endif
+	m_hMapping = NULL;
+	m_hFile = NULL;
+	m_IsOpen = false;
+	m_Size = 0;
+	m_ModifiedTime = 0;
+}
+
+void MappedFile::MapView(long long offset, size_t length)
+{
+	if (!m_IsOpen || offset < 0 || offset + (long long)length > m_Size)
+		throw SSAMException("file reading failed");
+
+	UnmapView();
+	static const long long granularity = GetAllocationGranularity();
+	long long viewOffset = (offset / granularity) * granularity;
+	long long viewSize = std::max(MAX_VIEW_SIZE, (long long)length + (offset - viewOffset));
+	viewSize = std::min(viewSize, m_Size - viewOffset);
+
+#ifdef _WIN32
+	void* p = MapViewOfFile(m_hMapping, FILE_MAP_READ,
+		(DWORD)(viewOffset >> 32), (DWORD)(viewOffset & 0xFFFFFFFF), (SIZE_T)viewSize);
+	if (p == NULL)
+		throw SSAMException("File \"" + m_FileName + "\" could not be mapped into memory.");
+#else
+	void* p = mmap(NULL, (size_t)viewSize, PROT_READ, MAP_PRIVATE, *static_cast<int*>(m_hFile), viewOffset);
+	if (p == MAP_FAILED)
+		throw SSAMException("File \"" + m_FileName + "\" could not be mapped into memory.");
+	madvise(p, (size_t)viewSize, MADV_SEQUENTIAL);
+#endif
+	m_pView = static_cast<const char*>(p);
+	m_ViewOffset = viewOffset;
+	m_ViewSize = (size_t)viewSize;
+}
+
+void MappedFile::UnmapView()
+{
+	if (m_pView != NULL)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(m_pView);
+#else
+		munmap(const_cast<char*>(m_pView), m_ViewSize);
+#endif
+	}
+	m_pView = NULL;
+	m_ViewOffset = 0;
+	m_ViewSize = 0;
+}
@@ -19,7 +19,42 @@
 ------------------------------------------------------------------------------*/
 #include "stdafx.h"
 #include <cmath>
+#include <algorithm>
 #include "Vehicle.h"
+#include "VehicleTracks.h"
+#include "CollisionKernel.h"
+
+namespace
+{
+	/** Test the edges of a footprint against a batch of footprints, and append the collided ones.
+	* @param cornerX X coordinates of the corners of the footprint
+	* @param cornerY Y coordinates of the corners of the footprint
+	* @param batchX X coordinates of the corners of the batch, laid out for CollisionKernel::CrossEdges
+	* @param batchY Y coordinates of the corners of the batch, laid out for CollisionKernel::CrossEdges
+	* @param batch indexes of the footprints of the batch
+	* @param nBatch number of footprints in the batch, a partial batch repeats its last footprint
+	* @param crashes indexes of the collided footprints are appended
+	*/
+	void TestBatch(const float* cornerX, const float* cornerY, float* batchX, float* batchY, 
+		const int* batch, int nBatch, std::vector<int>& crashes)
+	{
+		const int B = CollisionKernel::BATCH_SIZE;
+		for(int b = nBatch; b < B; b++)
+		{
+			for(int k = 0; k < 4; k++)
+			{
+				batchX[B*k + b] = batchX[B*k + nBatch - 1];
+				batchY[B*k + b] = batchY[B*k + nBatch - 1];
+			}
+		}
+		int crossed = CollisionKernel::CrossEdges(cornerX, cornerY, batchX, batchY);
+		for(int b = 0; b < nBatch; b++)
+		{
+			if(crossed & (1 << b))
+				crashes.push_back(batch[b]);
+		}
+	}
+}
 
 void Vehicle::SetPosition(float frontX, float frontY, float rearX, float rearY)
 {
@@ -27,139 +62,268 @@ void Vehicle::SetPosition(float frontX, float frontY, float rearX, float rearY)
 	m_FrontY = frontY;
 	m_RearX  = rearX;
 	m_RearY  = rearY;
-		
-	float dist = m_ScaledWidth / 2.0;
+	CalcFootprint(frontX, frontY, rearX, rearY, m_ScaledWidth, m_CornerX, m_CornerY, m_MinX, m_MinY, m_MaxX, m_MaxY);
+}
+
+void Vehicle::CalcFootprint(float frontX, float frontY, float rearX, float rearY, float scaledWidth,
+	float* cornerX, float* cornerY, float& minX, float& minY, float& maxX, float& maxY)
+{
+	float dist = scaledWidth / 2.0;
 	float dx=0, dy=0;
 	CalcPerpOffset(frontX, frontY, rearX, rearY, dist, dx, dy);
 
-	m_CornerX[FRONT_RIGHT] = m_FrontX + dx; 
-	m_CornerY[FRONT_RIGHT] = m_FrontY + dy; 
-	m_CornerX[FRONT_LEFT]  = m_FrontX - dx; 
-	m_CornerY[FRONT_LEFT]  = m_FrontY - dy; 
+	cornerX[FRONT_RIGHT] = frontX + dx; 
+	cornerY[FRONT_RIGHT] = frontY + dy; 
+	cornerX[FRONT_LEFT]  = frontX - dx; 
+	cornerY[FRONT_LEFT]  = frontY - dy; 
 
 	CalcPerpOffset(rearX, rearY, frontX, frontY, dist, dx, dy);
-	m_CornerX[REAR_LEFT]   = m_RearX  + dx; 
-	m_CornerY[REAR_LEFT]   = m_RearY  + dy; 
-	m_CornerX[REAR_RIGHT]  = m_RearX  - dx; 
-	m_CornerY[REAR_RIGHT]  = m_RearY  - dy; 
+	cornerX[REAR_LEFT]   = rearX  + dx; 
+	cornerY[REAR_LEFT]   = rearY  + dy; 
+	cornerX[REAR_RIGHT]  = rearX  - dx; 
+	cornerY[REAR_RIGHT]  = rearY  - dy; 
 	
-	m_MinX = m_CornerX[0];
-	m_MaxX = m_CornerX[0];
-	m_MinY = m_CornerY[0];
-	m_MaxY = m_CornerY[0];
+	minX = cornerX[0];
+	maxX = cornerX[0];
+	minY = cornerY[0];
+	maxY = cornerY[0];
 	for(int i = 1; i < 4; i++)
 	{
-		if(m_CornerX[i] < m_MinX)
-			m_MinX = m_CornerX[i];
-		if(m_CornerX[i] > m_MaxX)
-			m_MaxX = m_CornerX[i];
-		if(m_CornerY[i] < m_MinY)
-			m_MinY = m_CornerY[i];
-		if(m_CornerY[i] > m_MaxY)
-			m_MaxY = m_CornerY[i];
+		if(cornerX[i] < minX)
+			minX = cornerX[i];
+		if(cornerX[i] > maxX)
+			maxX = cornerX[i];
+		if(cornerY[i] < minY)
+			minY = cornerY[i];
+		if(cornerY[i] > maxY)
+			maxY = cornerY[i];
 	}		
 }
 
-SP_Vehicle Vehicle::CalcProjection(float maxTTC, float maxPET)
+void Vehicle::CalcProjection(float maxTTC, float maxPET, const VehicleTracks& tracks, VehicleShapes& shapes, size_t i) const
 {
 	float dist = maxTTC * m_Speed;
 	
 	if(m_Scale <= 0)
 		throw SSAMException("Vehicle projection not possible, since scale is unspecified.");
 	float fullDist = dist/m_Scale;
-	float remnDist = fullDist;
+	if(fullDist <= 0)
+	{
+		shapes.Set(i, *this);
+		return;
+	}
 
-	SP_Vehicle vehLast = std::make_shared<Vehicle>( *this);
-	while(remnDist > 0)
+	const Vehicle* vehLast = this;
+	if(m_Track >= 0)
 	{
-		SP_Vehicle vehNext = vehLast->GetNext();
-		if(vehNext != NULL)
+		size_t nPoints = 0;
+		const TrackPoint* points = tracks.GetPoints(m_Track, m_TrackPos, nPoints);
+		const TrackPoint* pEnd = points + nPoints;
+
+		// the trajectory ends at the first time step without movement
+		const TrackPoint* pStop = std::upper_bound(points + 1, pEnd, points[0].m_NStops, 
+			[](int nStops, const TrackPoint& p) { return nStops < p.m_NStops; });
+		// the projection is on the step into the first point at least fullDist ahead
+		double arcProj = points[0].m_Arc + fullDist;
+		const TrackPoint* pNext = std::lower_bound(points + 1, pStop, arcProj, 
+			[](const TrackPoint& p, double arc) { return p.m_Arc < arc; });
+		if(pNext != pStop)
 		{
-			float stepDist = vehNext->GetV2VDistance(*vehLast);
-			if(stepDist <= 0) 
-			{
-				return vehLast;
-			}
-			else if(remnDist > stepDist) 
-			{
-				vehLast = vehNext;
-				remnDist -= stepDist;
-			}
-			else 
-			{
-				float halfLengthXY = m_ScaledLength/2.0;
-				float rearDistScale = (remnDist - halfLengthXY)/stepDist;
-				float frontDistScale = (remnDist + halfLengthXY)/stepDist;
-				float lastCX = vehLast->GetCenterX();
-				float lastCY = vehLast->GetCenterY();
-				float deltaX = vehNext->GetCenterX() - lastCX;
-				float deltaY = vehNext->GetCenterY() - lastCY;
-
-				float projFX = lastCX + frontDistScale * deltaX;
-				float projFY = lastCY + frontDistScale * deltaY;
-				float projRX = lastCX + rearDistScale * deltaX;
-				float projRY = lastCY + rearDistScale * deltaY;
-
-				SP_Vehicle v = std::make_shared<Vehicle>(*this);
-				v->SetPosition(projFX, projFY, projRX, projRY);
-				return v;					
-			}
+			const Vehicle* vehNext = pNext->m_pVehicle;
+			vehLast = (pNext - 1)->m_pVehicle;
+			float stepDist = pNext->m_StepDist;
+			float remnDist = (float)(arcProj - (pNext - 1)->m_Arc);
+
+			float halfLengthXY = m_ScaledLength/2.0;
+			float rearDistScale = (remnDist - halfLengthXY)/stepDist;
+			float frontDistScale = (remnDist + halfLengthXY)/stepDist;
+			float lastCX = vehLast->GetCenterX();
+			float lastCY = vehLast->GetCenterY();
+			float deltaX = vehNext->GetCenterX() - lastCX;
+			float deltaY = vehNext->GetCenterY() - lastCY;
+
+			float projFX = lastCX + frontDistScale * deltaX;
+			float projFY = lastCY + frontDistScale * deltaY;
+			float projRX = lastCX + rearDistScale * deltaX;
+			float projRY = lastCY + rearDistScale * deltaY;
+
+			shapes.SetPosition(i, *this, projFX, projFY, projRX, projRY);
+			return;					
 		}
-		else 
+		vehLast = (pStop - 1)->m_pVehicle;
+		if(pStop != pEnd)
 		{
-			float projTime = vehLast->GetTimeStep() - GetTimeStep();
-			if(projTime < maxPET)
+			shapes.Set(i, *vehLast);
+			return;
+		}
+	}
+
+	// the trajectory in the window is shorter than fullDist
+	float projTime = vehLast->GetTimeStep() - GetTimeStep();
+	if(projTime < maxPET)
+	{
+		float remTime = maxTTC - projTime;
+		float speedX 	= m_Speed*(vehLast->GetFrontX() - vehLast->GetRearX())/m_ScaledLength;
+		float speedY 	= m_Speed*(vehLast->GetFrontY() - vehLast->GetRearY())/m_ScaledLength;
+		float projFX 	= vehLast->GetFrontX() + remTime * speedX;
+		float projFY 	= vehLast->GetFrontY() + remTime * speedY;
+		float projRX 	= vehLast->GetRearX()  + remTime * speedX;
+		float projRY 	= vehLast->GetRearY()  + remTime * speedY;
+
+		shapes.SetPosition(i, *this, projFX, projFY, projRX, projRY);
+		return;						
+	}
+	shapes.Set(i, *vehLast);
+}
+
+void Vehicle::CalcPath(float maxTTC, float maxPET, const VehicleTracks& tracks, std::vector<PathPiece>& path) const
+{
+	if(m_Scale <= 0)
+		throw SSAMException("Vehicle projection not possible, since scale is unspecified.");
+	float speedXY = m_Speed/m_Scale;
+
+	path.clear();
+	PathPiece piece;
+	piece.m_StartTime = 0;
+	piece.m_EndTime = 0;
+	for (int k = 0; k < 4; ++k)
+	{
+		piece.m_CornerX[k] = m_CornerX[k];
+		piece.m_CornerY[k] = m_CornerY[k];
+	}
+	piece.m_VelocityX = 0;
+	piece.m_VelocityY = 0;
+	piece.m_CenterZ = GetCenterZ();
+	if(speedXY <= 0 || maxTTC <= 0)
+	{
+		// the projection stays at the vehicle
+		piece.m_EndTime = maxTTC > 0 ? maxTTC : 0;
+		path.push_back(piece);
+		return;
+	}
+	path.push_back(piece);
+
+	float minX, minY, maxX, maxY;
+	float tReach = 0;
+	const Vehicle* vehLast = this;
+	if(m_Track >= 0)
+	{
+		size_t nPoints = 0;
+		const TrackPoint* points = tracks.GetPoints(m_Track, m_TrackPos, nPoints);
+		const TrackPoint* pEnd = points + nPoints;
+		const TrackPoint* pStop = std::upper_bound(points + 1, pEnd, points[0].m_NStops, 
+			[](int nStops, const TrackPoint& p) { return nStops < p.m_NStops; });
+
+		// on the step into a point, the projection moves along the step with the orientation of the step
+		float halfLengthXY = m_ScaledLength/2.0;
+		for (const TrackPoint* pNext = points + 1; pNext != pStop; ++pNext)
+		{
+			tReach = (float)((pNext->m_Arc - points[0].m_Arc)/speedXY);
+			const Vehicle* vehPrev = (pNext - 1)->m_pVehicle;
+			const Vehicle* vehNext = pNext->m_pVehicle;
+			float stepDist = pNext->m_StepDist;
+			float lastCX = vehPrev->GetCenterX();
+			float lastCY = vehPrev->GetCenterY();
+			float deltaX = vehNext->GetCenterX() - lastCX;
+			float deltaY = vehNext->GetCenterY() - lastCY;
+
+			piece.m_StartTime = piece.m_EndTime;
+			piece.m_EndTime = tReach < maxTTC ? tReach : maxTTC;
+			float remnDist = (float)(piece.m_StartTime*speedXY - ((pNext - 1)->m_Arc - points[0].m_Arc));
+			float rearDistScale = (remnDist - halfLengthXY)/stepDist;
+			float frontDistScale = (remnDist + halfLengthXY)/stepDist;
+			CalcFootprint(lastCX + frontDistScale * deltaX, lastCY + frontDistScale * deltaY, 
+				lastCX + rearDistScale * deltaX, lastCY + rearDistScale * deltaY, 
+				m_ScaledWidth, piece.m_CornerX, piece.m_CornerY, minX, minY, maxX, maxY);
+			piece.m_VelocityX = speedXY * deltaX/stepDist;
+			piece.m_VelocityY = speedXY * deltaY/stepDist;
+			piece.m_CenterZ = GetCenterZ();
+			path.push_back(piece);
+			if(tReach >= maxTTC)
+				return;
+		}
+		vehLast = (pStop - 1)->m_pVehicle;
+		if(pStop != pEnd)
+		{
+			// the projection stays at the first time step without movement
+			piece.m_StartTime = piece.m_EndTime;
+			piece.m_EndTime = maxTTC;
+			for (int k = 0; k < 4; ++k)
 			{
-				float remTime = maxTTC - projTime;
-				float speedX 	= m_Speed*(vehLast->GetFrontX() - vehLast->GetRearX())/m_ScaledLength;
-				float speedY 	= m_Speed*(vehLast->GetFrontY() - vehLast->GetRearY())/m_ScaledLength;
-				float projFX 	= vehLast->GetFrontX() + remTime * speedX;
-				float projFY 	= vehLast->GetFrontY() + remTime * speedY;
-				float projRX 	= vehLast->GetRearX()  + remTime * speedX;
-				float projRY 	= vehLast->GetRearY()  + remTime * speedY;
-
-				SP_Vehicle v = std::make_shared<Vehicle>(*this);
-				v->SetPosition(projFX, projFY, projRX, projRY);
-				return v;						
+				piece.m_CornerX[k] = vehLast->m_CornerX[k];
+				piece.m_CornerY[k] = vehLast->m_CornerY[k];
 			}
-			return vehLast;
+			piece.m_VelocityX = 0;
+			piece.m_VelocityY = 0;
+			piece.m_CenterZ = vehLast->GetCenterZ();
+			path.push_back(piece);
+			return;
+		}
+	}
+
+	// beyond the trajectory in the window
+	piece.m_StartTime = piece.m_EndTime;
+	piece.m_EndTime = maxTTC;
+	float projTime = vehLast->GetTimeStep() - GetTimeStep();
+	if(projTime < maxPET)
+	{
+		float remTime = piece.m_StartTime - projTime;
+		float speedX 	= m_Speed*(vehLast->GetFrontX() - vehLast->GetRearX())/m_ScaledLength;
+		float speedY 	= m_Speed*(vehLast->GetFrontY() - vehLast->GetRearY())/m_ScaledLength;
+		CalcFootprint(vehLast->GetFrontX() + remTime * speedX, vehLast->GetFrontY() + remTime * speedY, 
+			vehLast->GetRearX() + remTime * speedX, vehLast->GetRearY() + remTime * speedY, 
+			m_ScaledWidth, piece.m_CornerX, piece.m_CornerY, minX, minY, maxX, maxY);
+		piece.m_VelocityX = speedX;
+		piece.m_VelocityY = speedY;
+		piece.m_CenterZ = GetCenterZ();
+	}
+	else
+	{
+		for (int k = 0; k < 4; ++k)
+		{
+			piece.m_CornerX[k] = vehLast->m_CornerX[k];
+			piece.m_CornerY[k] = vehLast->m_CornerY[k];
 		}
+		piece.m_VelocityX = 0;
+		piece.m_VelocityY = 0;
+		piece.m_CenterZ = vehLast->GetCenterZ();
 	}
-	return vehLast;
+	path.push_back(piece);
 }
 
-bool Vehicle::IsCollided(SP_Vehicle v)
+void Vehicle::FindCollisions(const Vehicle* others, size_t n, std::vector<int>& crashes) const
 {
-	// considered as at two levels if more than 5 ft apart in elevation
-	if (abs(GetCenterZ() - v->GetCenterZ()) > 5.0) 
-		return false;
-	
-	if	(	(m_MaxX < v->GetMinX())
-		||	(m_MinX > v->GetMaxX())
-		||	(m_MaxY < v->GetMinY())
-		||	(m_MinY > v->GetMaxY())
-		)
-		return false;
+	crashes.clear();
 
-	int i,j,iNext,jNext;
-	for(i = 0; i < 4; i++)
+	const int B = CollisionKernel::BATCH_SIZE;
+	float batchX[4*B], batchY[4*B];
+	int batch[B];
+	int nBatch = 0;
+	for(size_t i = 0; i < n; i++)
 	{
-		iNext = (i+1)%4;
-		for(j = 0; j < 4; j++)
+		// the elevation and the bounding box reject most vehicles before their edges are tested
+		const Vehicle& v = others[i];
+		if (!(abs(GetCenterZ() - v.GetCenterZ()) > 5.0)
+			&& !(	(m_MaxX < v.GetMinX())
+				||	(m_MinX > v.GetMaxX())
+				||	(m_MaxY < v.GetMinY())
+				||	(m_MinY > v.GetMaxY())))
 		{
-			jNext = (j+1)%4;
-			if(CheckLinesIntersect(	m_CornerX[i], 
-										m_CornerY[i], 
-										m_CornerX[iNext], 
-										m_CornerY[iNext],
-										v->m_CornerX[j], 
-										v->m_CornerY[j], 
-										v->m_CornerX[jNext], 
-										v->m_CornerY[jNext]))
-				return true;
+			for(int k = 0; k < 4; k++)
+			{
+				batchX[B*k + nBatch] = v.m_CornerX[k];
+				batchY[B*k + nBatch] = v.m_CornerY[k];
+			}
+			batch[nBatch++] = (int)i;
+			if(nBatch == B)
+			{
+				TestBatch(m_CornerX, m_CornerY, batchX, batchY, batch, nBatch, crashes);
+				nBatch = 0;
+			}
 		}
 	}
-	return false;
+	if(nBatch > 0)
+		TestBatch(m_CornerX, m_CornerY, batchX, batchY, batch, nBatch, crashes);
 }
 
 void Vehicle::Print(std::ostream& output, float version)
@@ -210,3 +374,102 @@ void Vehicle::CalcPerpOffset(float x1, float y1, float x2, float y2, float dist,
 	if(x2 < x1)
 		dy *= -1;
 }
+
+void VehicleShapes::Set(size_t i, const Vehicle& v)
+{
+	const float* cornerX = v.GetCornerXs();
+	const float* cornerY = v.GetCornerYs();
+	for (int k = 0; k < 4; ++k)
+	{
+		m_CornerX[4*i + k] = cornerX[k];
+		m_CornerY[4*i + k] = cornerY[k];
+	}
+	m_MinX[i] = v.GetMinX();
+	m_MinY[i] = v.GetMinY();
+	m_MaxX[i] = v.GetMaxX();
+	m_MaxY[i] = v.GetMaxY();
+	m_CenterX[i] = v.GetCenterX();
+	m_CenterY[i] = v.GetCenterY();
+	m_CenterZ[i] = v.GetCenterZ();
+}
+
+void VehicleShapes::SetPosition(size_t i, const Vehicle& v, float frontX, float frontY, float rearX, float rearY)
+{
+	Vehicle::CalcFootprint(frontX, frontY, rearX, rearY, v.GetScaledWidth(),
+		&m_CornerX[4*i], &m_CornerY[4*i], m_MinX[i], m_MinY[i], m_MaxX[i], m_MaxY[i]);
+	// the same expressions as Vehicle::GetCenterX() and Vehicle::GetCenterY()
+	m_CenterX[i] = rearX + (frontX-rearX)/2.0;
+	m_CenterY[i] = rearY + (frontY-rearY)/2.0;
+	m_CenterZ[i] = v.GetCenterZ();
+}
+
+bool VehicleShapes::IsCollided(size_t i, size_t j) const
+{
+	// considered as at two levels if more than 5 ft apart in elevation
+	if (abs(m_CenterZ[i] - m_CenterZ[j]) > 5.0) 
+		return false;
+	
+	if	(	(m_MaxX[i] < m_MinX[j])
+		||	(m_MinX[i] > m_MaxX[j])
+		||	(m_MaxY[i] < m_MinY[j])
+		||	(m_MinY[i] > m_MaxY[j])
+		)
+		return false;
+
+	const float* cornerXi = &m_CornerX[4*i];
+	const float* cornerYi = &m_CornerY[4*i];
+	const float* cornerXj = &m_CornerX[4*j];
+	const float* cornerYj = &m_CornerY[4*j];
+	int k,l,kNext,lNext;
+	for(k = 0; k < 4; k++)
+	{
+		kNext = (k+1)%4;
+		for(l = 0; l < 4; l++)
+		{
+			lNext = (l+1)%4;
+			if(CheckLinesIntersect(	cornerXi[k], 
+										cornerYi[k], 
+										cornerXi[kNext], 
+										cornerYi[kNext],
+										cornerXj[l], 
+										cornerYj[l], 
+										cornerXj[lNext], 
+										cornerYj[lNext]))
+				return true;
+		}
+	}
+	return false;
+}
+
+void VehicleShapes::FindCollisions(size_t i, const int* candidates, size_t n, std::vector<int>& crashes) const
+{
+	const int B = CollisionKernel::BATCH_SIZE;
+	float batchX[4*B], batchY[4*B];
+	int batch[B];
+	int nBatch = 0;
+	for(size_t c = 0; c < n; c++)
+	{
+		// the elevation and the bounding box reject most footprints before their edges are tested
+		size_t j = candidates[c];
+		if (!(abs(m_CenterZ[i] - m_CenterZ[j]) > 5.0)
+			&& !(	(m_MaxX[i] < m_MinX[j])
+				||	(m_MinX[i] > m_MaxX[j])
+				||	(m_MaxY[i] < m_MinY[j])
+				||	(m_MinY[i] > m_MaxY[j])))
+		{
+			for(int k = 0; k < 4; k++)
+			{
+				batchX[B*k + nBatch] = m_CornerX[4*j + k];
+				batchY[B*k + nBatch] = m_CornerY[4*j + k];
+			}
+			batch[nBatch++] = candidates[c];
+			if(nBatch == B)
+			{
+				TestBatch(&m_CornerX[4*i], &m_CornerY[4*i], batchX, batchY, batch, nBatch, crashes);
+				nBatch = 0;
+			}
+		}
+	}
+	if(nBatch > 0)
+		TestBatch(&m_CornerX[4*i], &m_CornerY[4*i], batchX, batchY, batch, nBatch, crashes);
+}
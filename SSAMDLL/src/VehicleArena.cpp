@@ -0,0 +1,138 @@
+/*------------------------------------------------------------------------------
+   Copyright  2016-2017
+   New Global Systems for Intelligent Transportation Management Corp.
+
+   This file is part of SSAM.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Affero General Public License as
+   published by the Free Software Foundation, either version 3 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------------*/
+#include "stdafx.h"
+#include <atomic>
+#include "VehicleArena.h"
+
+VehicleArena::VehicleArena()
+	: m_Block (0)
+	, m_NVehicles (0)
+	, m_NAllocated (0)
+	, m_NBlocks (0)
+{
+}
+
+Vehicle& VehicleArena::Allocate()
+{
+	while (m_Block < m_Blocks.size() && m_Blocks[m_Block].size() == m_Blocks[m_Block].capacity())
+		++m_Block;
+	if (m_Block == m_Blocks.size())
+	{
+		// each new block doubles the capacity of the arena
+		m_Blocks.push_back(std::vector<Vehicle>());
+		m_Blocks.back().reserve((m_NVehicles > MIN_BLOCK_SIZE) ? m_NVehicles : MIN_BLOCK_SIZE);
+		++m_NBlocks;
+	}
+	m_Blocks[m_Block].push_back(Vehicle());
+	++m_NVehicles;
+	++m_NAllocated;
+	return m_Blocks[m_Block].back();
+}
+
+void VehicleArena::FreeLast()
+{
+	m_Blocks[m_Block].pop_back();
+	--m_NVehicles;
+}
+
+void VehicleArena::Reset()
+{
+	// the vehicles of the time step are dropped, keeping the capacity of the blocks
+	size_t capacity = 0;
+	for (size_t i = 0; i < m_Blocks.size(); ++i)
+	{
+		m_Blocks[i].clear();
+		capacity += m_Blocks[i].capacity();
+	}
+	if (m_Blocks.size() > 1)
+	{
+		// a time step that needed several blocks gets them merged into one for the next use
+		m_Blocks.clear();
+		m_Blocks.push_back(std::vector<Vehicle>());
+		m_Blocks.back().reserve(capacity);
+		++m_NBlocks;
+	}
+	m_Block = 0;
+	m_NVehicles = 0;
+}
+
+VehiclePool::VehiclePool()
+	: m_Next (0)
+	, m_NVehicles (0)
+	, m_NBlocks (0)
+	, m_NArenas (0)
+	, m_NReuses (0)
+{
+}
+
+SP_VehicleArena VehiclePool::Acquire()
+{
+	// time steps are released in the order they were read, so the search starts after the last acquired arena
+	for (size_t k = 0; k < m_Arenas.size(); ++k)
+	{
+		size_t i = (m_Next + k) % m_Arenas.size();
+		if (m_Arenas[i].use_count() == 1)
+		{
+			// the last vehicle may have been released by another thread
+			std::atomic_thread_fence(std::memory_order_acquire);
+			m_Arenas[i]->Reset();
+			m_Next = (i + 1) % m_Arenas.size();
+			++m_NReuses;
+			return m_Arenas[i];
+		}
+	}
+	SP_VehicleArena pArena = std::make_shared<VehicleArena>();
+	m_Arenas.insert(m_Arenas.begin() + m_Next, pArena);
+	m_Next = (m_Next + 1) % m_Arenas.size();
+	++m_NArenas;
+	return pArena;
+}
+
+void VehiclePool::Clear()
+{
+	m_NVehicles = GetNVehicles();
+	m_NBlocks = GetNBlocks();
+	m_Arenas.clear();
+	m_Next = 0;
+}
+
+void VehiclePool::AddCounts(const VehiclePool& other)
+{
+	m_NVehicles += other.GetNVehicles();
+	m_NBlocks += other.GetNBlocks();
+	m_NArenas += other.m_NArenas;
+	m_NReuses += other.m_NReuses;
+}
+
+long long VehiclePool::GetNVehicles() const
+{
+	long long n = m_NVehicles;
+	for (size_t i = 0; i < m_Arenas.size(); ++i)
+		n += m_Arenas[i]->GetNAllocated();
+	return n;
+}
+
+long long VehiclePool::GetNBlocks() const
+{
+	long long n = m_NBlocks;
+	for (size_t i = 0; i < m_Arenas.size(); ++i)
+		n += m_Arenas[i]->GetNBlocks();
+	return n;
+}
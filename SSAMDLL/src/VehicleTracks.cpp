@@ -0,0 +1,106 @@
+/*------------------------------------------------------------------------------
+   Copyright  2016-2017
+   New Global Systems for Intelligent Transportation Management Corp.
+
+   This file is part of SSAM.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Affero General Public License as
+   published by the Free Software Foundation, either version 3 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------------*/
+#include "stdafx.h"
+#include "VehicleTracks.h"
+
+void VehicleTracks::AddTimeStep(const StepVehicles* pPrevStep, const StepVehicles& step)
+{
+	if (pPrevStep != NULL)
+	{
+		for (size_t i = 0; i < pPrevStep->size(); ++i)
+		{
+			const Vehicle& vPrev = *(*pPrevStep)[i];
+			if (vPrev.GetNextIndex() < 0)
+				continue;
+			Vehicle& v = *step[vPrev.GetNextIndex()];
+			Track& t = m_Tracks[vPrev.GetTrack()];
+			const TrackPoint& last = t.m_Points.back();
+			TrackPoint p;
+			p.m_pVehicle = &v;
+			p.m_StepDist = v.GetV2VDistance(vPrev);
+			p.m_Arc = last.m_Arc + p.m_StepDist;
+			p.m_NStops = last.m_NStops + (p.m_StepDist <= 0 ? 1 : 0);
+			t.m_Points.push_back(p);
+			v.SetTrack(vPrev.GetTrack(), vPrev.GetTrackPos() + 1);
+		}
+	}
+	for (size_t i = 0; i < step.size(); ++i)
+	{
+		if (step[i]->GetTrack() < 0)
+			StartTrack(*step[i]);
+	}
+}
+
+void VehicleTracks::RemoveTimeStep(const StepVehicles& step)
+{
+	for (size_t i = 0; i < step.size(); ++i)
+	{
+		int track = step[i]->GetTrack();
+		if (track < 0)
+			continue;
+		Track& t = m_Tracks[track];
+		++t.m_First;
+		++t.m_FirstPos;
+		if (t.m_First == t.m_Points.size())
+		{
+			// the vehicle has left the window
+			t.m_Points.clear();
+			m_FreeTracks.push_back(track);
+		} else if (t.m_First >= 64 && 2 * t.m_First >= t.m_Points.size())
+		{
+			t.m_Points.erase(t.m_Points.begin(), t.m_Points.begin() + t.m_First);
+			t.m_First = 0;
+		}
+	}
+}
+
+void VehicleTracks::Clear()
+{
+	m_FreeTracks.clear();
+	for (size_t i = 0; i < m_Tracks.size(); ++i)
+	{
+		m_Tracks[i].m_Points.clear();
+		m_FreeTracks.push_back((int)i);
+	}
+}
+
+void VehicleTracks::StartTrack(Vehicle& v)
+{
+	int track = 0;
+	if (!m_FreeTracks.empty())
+	{
+		track = m_FreeTracks.back();
+		m_FreeTracks.pop_back();
+	} else
+	{
+		track = (int)m_Tracks.size();
+		m_Tracks.push_back(Track());
+	}
+	Track& t = m_Tracks[track];
+	t.m_First = 0;
+	t.m_FirstPos = 0;
+	TrackPoint p;
+	p.m_pVehicle = &v;
+	p.m_Arc = 0;
+	p.m_StepDist = 0;
+	p.m_NStops = 0;
+	t.m_Points.push_back(p);
+	v.SetTrack(track, 0);
+}
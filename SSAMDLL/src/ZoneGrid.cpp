@@ -20,8 +20,12 @@
 #include "stdafx.h"
 #include <cmath>
 #include <list>
+#include <algorithm>
 #include <iostream>
 #include "ZoneGrid.h"
+#ifdef _OPENMP_LOCAL
+#include <omp.h>
+#endif
 
 ZoneGrid::ZoneGrid()
 {
@@ -32,48 +36,226 @@ ZoneGrid::ZoneGrid(int xMin, int yMin, int xMax, int yMax, int size)
 	ResetGrid(xMin, yMin, xMax, yMax, size);
 }
 
-void ZoneGrid::AddVehicle(SP_Vehicle vNew, std::map<int, SP_Vehicle>& allCrashes)
+void ZoneGrid::ClearGrid()
 {
-	allCrashes.clear();
-	
-	if ((vNew->GetCenterX() < m_OrigMinX || vNew->GetCenterX() > m_OrigMaxX)|| 
-		(vNew->GetCenterY() < m_OrigMinY || vNew->GetCenterY() > m_OrigMaxY)) 
+	if (IsSparse())
+		m_HashZones.clear();
+	else
 	{
-		return;
+		for (size_t i = 0; i < m_OccupiedZones.size(); ++i)
+			m_ZoneSlots[(size_t)m_OccupiedZones[i]] = -1;
+	}
+	m_OccupiedZones.clear();
+	m_ZoneOffsets.clear();
+	m_ZoneVehicles.clear();
+}
+
+bool ZoneGrid::FindZones(const VehicleShapes& shapes, int i, ZoneRange& range) const
+{
+	if ((shapes.GetCenterX(i) < m_OrigMinX || shapes.GetCenterX(i) > m_OrigMaxX)|| 
+		(shapes.GetCenterY(i) < m_OrigMinY || shapes.GetCenterY(i) > m_OrigMaxY)) 
+	{
+		return false;
 	}
-	////----------------------------------------------------
 		
 	//	Get the axis-align bounding box, and
 	//	translate it to the zoneGrid origin,
-	double vxMin = vNew->GetMinX() - m_MinX;
-	double vxMax = vNew->GetMaxX() - m_MinX;
-	double vyMin = vNew->GetMinY() - m_MinY;
-	double vyMax = vNew->GetMaxY() - m_MinY;
+	double vxMin = shapes.GetMinX(i) - m_MinX;
+	double vxMax = shapes.GetMaxX(i) - m_MinX;
+	double vyMin = shapes.GetMinY(i) - m_MinY;
+	double vyMax = shapes.GetMaxY(i) - m_MinY;
 	//	calculate the range of x zones and y zones,
-	int ixMin = (int) floor(vxMin/m_ZoneSize);
-	int ixMax = (int) floor(vxMax/m_ZoneSize);
-	int iyMin = (int) floor(vyMin/m_ZoneSize);
-	int iyMax = (int) floor(vyMax/m_ZoneSize);
-	//	narrow the zone indices such that zones off the
-	//	grid are not considered
-	ixMin = std::max(ixMin,0);
-	ixMax = std::min(ixMax,m_NXZones-1);
-	iyMin = std::max(iyMin,0);
-	iyMax = std::min(iyMax,m_NYZones-1);
-	//	and add the vehicle to each zone.
+	//	narrowed such that zones off the grid are not considered
+	range.m_MinX = std::max((int) floor(vxMin/m_ZoneSize), 0);
+	range.m_MaxX = std::min((int) floor(vxMax/m_ZoneSize), m_NXZones-1);
+	range.m_MinY = std::max((int) floor(vyMin/m_ZoneSize), 0);
+	range.m_MaxY = std::min((int) floor(vyMax/m_ZoneSize), m_NYZones-1);
+	return true;
+}
+
+void ZoneGrid::Build(const VehicleShapes& shapes, const std::vector<int>& vehicles)
+{
+	ClearGrid();
+	if (vehicles.empty())
+		return;
+	m_Ranges.resize(vehicles.back() + 1);
+	int nVehicles = (int)vehicles.size();
+
+	//	find the zones of each vehicle
+	m_EntryStarts.resize(nVehicles + 1);
+	m_EntryStarts[0] = 0;
 #ifdef _OPENMP_LOCAL
-	#pragma omp critical (ADDZONE)
+	#pragma omp parallel for
 #endif
-	for(int ix = ixMin; ix <= ixMax; ix++)
+	for (int k = 0; k < nVehicles; ++k)
 	{
-		for(int iy = iyMin; iy <= iyMax; iy++)
+		ZoneRange& range = m_Ranges[vehicles[k]];
+		int nZones = 0;
+		if (FindZones(shapes, vehicles[k], range))
+			nZones = (range.m_MaxX - range.m_MinX + 1) * (range.m_MaxY - range.m_MinY + 1);
+		else
 		{
-			m_UsedZones.push_back(UsedZone(ix, iy));
-			m_Zones[ix][iy]->AddVehicle(vNew, allCrashes);
+			range.m_MinX = 0;
+			range.m_MaxX = -1;
 		}
+		m_EntryStarts[k + 1] = nZones;
+	}
+	for (int k = 0; k < nVehicles; ++k)
+		m_EntryStarts[k + 1] += m_EntryStarts[k];
+
+	int nEntries = m_EntryStarts[nVehicles];
+	m_EntryZones.resize(nEntries);
+	m_EntryRanks.resize(nEntries);
+#ifdef _OPENMP_LOCAL
+	#pragma omp parallel for
+#endif
+	for (int k = 0; k < nVehicles; ++k)
+	{
+		const ZoneRange& range = m_Ranges[vehicles[k]];
+		int e = m_EntryStarts[k];
+		for(int ix = range.m_MinX; ix <= range.m_MaxX; ix++)
+		{
+			for(int iy = range.m_MinY; iy <= range.m_MaxY; iy++)
+				m_EntryZones[e++] = (long long)ix * m_NYZones + iy;
+		}
+	}
+
+	//	count the vehicles of each zone, numbering the zones as they are first occupied
+	if (IsSparse())
+	{
+		// a table at most half full, with room for every entry in a different zone
+		size_t nHash = 16;
+		while (nHash < 2 * (size_t)nEntries)
+			nHash *= 2;
+		m_HashZones.assign(nHash, -1);
+		m_HashSlots.resize(nHash);
+	}
+	m_Fill.clear();
+	for (int e = 0; e < nEntries; ++e)
+	{
+		int& slot = FindSlot(m_EntryZones[e]);
+		if (slot < 0)
+		{
+			slot = (int)m_OccupiedZones.size();
+			m_OccupiedZones.push_back(m_EntryZones[e]);
+			m_Fill.push_back(0);
+		}
+		m_EntryZones[e] = slot;
+		m_EntryRanks[e] = m_Fill[slot]++;
+	}
+
+	//	the vehicles of a zone start after those of the zones occupied before
+	size_t nOccupied = m_OccupiedZones.size();
+	m_ZoneOffsets.resize(nOccupied + 1);
+	m_ZoneOffsets[0] = 0;
+	for (size_t slot = 0; slot < nOccupied; ++slot)
+		m_ZoneOffsets[slot + 1] = m_ZoneOffsets[slot] + m_Fill[slot];
+
+	//	and are stored in the order of the footprint indexes
+	m_ZoneVehicles.resize(nEntries);
+#ifdef _OPENMP_LOCAL
+	#pragma omp parallel for
+#endif
+	for (int k = 0; k < nVehicles; ++k)
+	{
+		for (int e = m_EntryStarts[k]; e < m_EntryStarts[k + 1]; ++e)
+			m_ZoneVehicles[m_ZoneOffsets[(size_t)m_EntryZones[e]] + m_EntryRanks[e]] = vehicles[k];
 	}
 }
+
+void ZoneGrid::FindCrashes(const VehicleShapes& shapes, std::vector<std::pair<int, int> >& crashes)
+{
+#ifdef _OPENMP_LOCAL
+	m_CrashBuffers.resize(omp_get_max_threads());
+#else
+	m_CrashBuffers.resize(1);
+#endif
+	for (size_t t = 0; t < m_CrashBuffers.size(); ++t)
+		m_CrashBuffers[t].m_Crashes.clear();
+
+	int nOccupied = (int)m_OccupiedZones.size();
+#ifdef _OPENMP_LOCAL
+	#pragma omp parallel for schedule(dynamic, 16)
+#endif
+	for (int slot = 0; slot < nOccupied; ++slot)
+	{
+#ifdef _OPENMP_LOCAL
+		CrashBuffer& buffer = m_CrashBuffers[omp_get_thread_num()];
+#else
+		CrashBuffer& buffer = m_CrashBuffers[0];
+#endif
+		int ix = (int)(m_OccupiedZones[slot] / m_NYZones);
+		int iy = (int)(m_OccupiedZones[slot] % m_NYZones);
+		const int* zoneVehicles = &m_ZoneVehicles[m_ZoneOffsets[slot]];
+		int n = m_ZoneOffsets[slot + 1] - m_ZoneOffsets[slot];
+		for (int k = 1; k < n; ++k)
+		{
+			//	a pair of vehicles sharing several zones is checked in the first zone they share
+			const ZoneRange& range = m_Ranges[zoneVehicles[k]];
+			buffer.m_Candidates.clear();
+			for (int j = 0; j < k; ++j)
+			{
+				const ZoneRange& other = m_Ranges[zoneVehicles[j]];
+				if (std::max(range.m_MinX, other.m_MinX) == ix && std::max(range.m_MinY, other.m_MinY) == iy)
+					buffer.m_Candidates.push_back(zoneVehicles[j]);
+			}
+			if (buffer.m_Candidates.empty())
+				continue;
+
+			buffer.m_Found.clear();
+			shapes.FindCollisions(zoneVehicles[k], buffer.m_Candidates.data(), buffer.m_Candidates.size(), buffer.m_Found);
+			for (size_t c = 0; c < buffer.m_Found.size(); ++c)
+				buffer.m_Crashes.push_back(std::pair<int, int>(buffer.m_Found[c], zoneVehicles[k]));
+		}
+	}
+
+	//	merge the crashes of the threads in an order that does not depend on the threads
+	crashes.clear();
+	for (size_t t = 0; t < m_CrashBuffers.size(); ++t)
+		crashes.insert(crashes.end(), m_CrashBuffers[t].m_Crashes.begin(), m_CrashBuffers[t].m_Crashes.end());
+	std::sort(crashes.begin(), crashes.end());
+}
 	
+int ZoneGrid::TuneZoneSize(const VehicleShapes& shapes, const std::vector<int>& vehicles, int baseSize)
+{
+	int currentSize = m_ZoneSize;
+	long long currentWork = -1;
+	int bestSize = currentSize;
+	long long bestWork = -1;
+	for (int scale = -2; scale <= 2; ++scale)
+	{
+		int size = (scale < 0) ? (baseSize >> -scale) : (baseSize << scale);
+		if (size < 1)
+			continue;
+		ResetGrid(m_OrigMinX, m_OrigMinY, m_OrigMaxX, m_OrigMaxY, size);
+		Build(shapes, vehicles);
+		long long work = CountWork();
+		if (size == currentSize)
+			currentWork = work;
+		if (bestWork < 0 || work < bestWork)
+		{
+			bestWork = work;
+			bestSize = size;
+		}
+	}
+	// the current size is kept unless another size saves a tenth of the work, so that the size does not flip
+	if (currentWork >= 0 && 10 * (currentWork - bestWork) < currentWork)
+		bestSize = currentSize;
+	ResetGrid(m_OrigMinX, m_OrigMinY, m_OrigMaxX, m_OrigMaxY, bestSize);
+	return bestSize;
+}
+
+long long ZoneGrid::CountWork() const
+{
+	long long work = m_ZoneVehicles.size();
+	for (size_t slot = 0; slot + 1 < m_ZoneOffsets.size(); ++slot)
+	{
+		long long n = m_ZoneOffsets[slot + 1] - m_ZoneOffsets[slot];
+		work += n * (n - 1) / 2;
+	}
+	return work;
+}
+
 void ZoneGrid::ResetGrid(int xMin, int yMin, int xMax, int yMax, int size)
 {
 	//store the original grid dimensions before expanding them
@@ -99,33 +281,34 @@ void ZoneGrid::ResetGrid(int xMin, int yMin, int xMax, int yMax, int size)
 		
 	m_NXZones = (m_MaxX - m_MinX)/m_ZoneSize; // should make sure > 0
 	m_NYZones = (m_MaxY - m_MinY)/m_ZoneSize; // should make sure > 0
-	m_NZones = m_NXZones*m_NYZones;
-	if(m_NZones > 5575680)//about 500 square miles assuming zones of 50 feet.
-		throw SSAMException("Safety analysis zone is too large.");
+	m_NZones = (long long)m_NXZones*m_NYZones;
 
-	m_Zones = std::vector<std::vector<SP_Zone> >(m_NXZones, std::vector<SP_Zone>(m_NYZones, NULL));
-	for (int i = 0; i < m_NXZones; ++i)
-	{
-		for (int j = 0; j < m_NYZones; ++j)
-		{
-			m_Zones[i][j] = std::make_shared<Zone>();
-		}
-	}
-	m_UsedZones.clear();
+	m_OccupiedZones.clear();
+	m_ZoneOffsets.clear();
+	m_ZoneVehicles.clear();
+	m_HashZones.clear();
+	if (IsSparse())
+		std::vector<int>().swap(m_ZoneSlots);
+	else
+		m_ZoneSlots.assign((size_t)m_NZones, -1);
 }
 
-void ZoneGrid::Zone::AddVehicle(SP_Vehicle vNew, std::map<int, SP_Vehicle>& allCrashes)
+int& ZoneGrid::FindSlot(long long zone)
 {
-	
-	SP_Vehicle vOther;		
-	std::list<SP_Vehicle>::iterator i = m_Occupants.begin();
-	for(; i != m_Occupants.end(); ++i)
+	if (!IsSparse())
+		return m_ZoneSlots[(size_t)zone];
+
+	size_t mask = m_HashZones.size() - 1;
+	size_t i = (size_t)(((unsigned long long)zone * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+	while (m_HashZones[i] != zone)
 	{
-		vOther = *i;
-		if(vNew->IsCollided(vOther))
+		if (m_HashZones[i] < 0)
 		{
-			allCrashes[vOther->GetVehicleID()] = vOther;
+			m_HashZones[i] = zone;
+			m_HashSlots[i] = -1;
+			break;
 		}
+		i = (i + 1) & mask;
 	}
-	m_Occupants.push_back(vNew);
-}
\ No newline at end of file
+	return m_HashSlots[i];
+}